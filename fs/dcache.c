@@ -74,6 +74,15 @@
 int sysctl_vfs_cache_pressure __read_mostly = 50;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/*
+ * Limits on unused negative dentries, per superblock and per parent
+ * directory.  Zero means unlimited.  Going over either limit kicks a
+ * background worker that trims negative dentries from the cold end of the
+ * superblock LRU, without waiting for memory pressure.
+ */
+unsigned long sysctl_negative_dentry_limit __read_mostly;
+unsigned int sysctl_negative_dentry_dir_limit __read_mostly;
+
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
 EXPORT_SYMBOL(rename_lock);
@@ -122,6 +131,7 @@ struct dentry_stat_t dentry_stat = {
 static DEFINE_PER_CPU(long, nr_dentry);
 static DEFINE_PER_CPU(long, nr_dentry_unused);
 static DEFINE_PER_CPU(long, nr_dentry_negative);
+static atomic_long_t nr_dentry_negative_trimmed;
 
 #if defined(CONFIG_SYSCTL) && defined(CONFIG_PROC_FS)
 
@@ -171,6 +181,8 @@ int proc_nr_dentry(struct ctl_table *table, int write, void __user *buffer,
 	dentry_stat.nr_dentry = get_nr_dentry();
 	dentry_stat.nr_unused = get_nr_dentry_unused();
 	dentry_stat.nr_negative = get_nr_dentry_negative();
+	dentry_stat.nr_negative_trimmed =
+		atomic_long_read(&nr_dentry_negative_trimmed);
 	return proc_doulongvec_minmax(table, write, buffer, lenp, ppos);
 }
 #endif
@@ -322,6 +334,94 @@ static inline void __d_set_inode_and_type(struct dentry *dentry,
 	WRITE_ONCE(dentry->d_flags, flags);
 }
 
+static void negative_dentry_trim_workfn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(negative_dentry_trim_work,
+			    negative_dentry_trim_workfn);
+
+/* Give the trimmer a moment to batch up kicks from a burst of lookups */
+#define NEGATIVE_DENTRY_TRIM_DELAY	(HZ / 10)
+
+/*
+ * Negative dentries are counted per parent directory in the directory inode.
+ * A child pins its parent dentry, and the parent cannot lose its inode while
+ * it has children, so the counter is stable under the child's d_lock.
+ */
+static inline atomic_t *d_parent_nr_negative(struct dentry *dentry)
+{
+	struct inode *dir;
+
+	if (IS_ROOT(dentry))
+		return NULL;
+	dir = dentry->d_parent->d_inode;
+	if (!dir || !S_ISDIR(dir->i_mode))
+		return NULL;
+	return &dir->i_dir_nr_negative;
+}
+
+/* Compare as signed, so that a count that went negative doesn't look huge */
+static inline bool d_negative_dir_over(int nr, unsigned int limit)
+{
+	return limit && nr > 0 && (unsigned int)nr > limit;
+}
+
+/*
+ * Account an unused negative dentry entering the superblock LRU, and kick
+ * the background trimmer if that takes its superblock or its parent
+ * directory over the limit.  d_lock must be held by the caller.
+ */
+static void d_negative_inc(struct dentry *dentry)
+{
+	struct super_block *sb = dentry->d_sb;
+	unsigned long sb_limit = READ_ONCE(sysctl_negative_dentry_limit);
+	unsigned int dir_limit = READ_ONCE(sysctl_negative_dentry_dir_limit);
+	atomic_t *nr_dir = d_parent_nr_negative(dentry);
+	bool kick = false;
+
+	this_cpu_inc(nr_dentry_negative);
+	percpu_counter_inc(&sb->s_nr_dentry_negative);
+
+	if (nr_dir &&
+	    d_negative_dir_over(atomic_inc_return(nr_dir), dir_limit)) {
+		atomic_long_inc(&sb->s_nr_negative_dir_excess);
+		kick = true;
+	}
+	if (sb_limit &&
+	    percpu_counter_read_positive(&sb->s_nr_dentry_negative) > sb_limit)
+		kick = true;
+
+	if (kick && !delayed_work_pending(&negative_dentry_trim_work))
+		queue_delayed_work(system_unbound_wq, &negative_dentry_trim_work,
+				   NEGATIVE_DENTRY_TRIM_DELAY);
+}
+
+static void d_negative_dec(struct dentry *dentry)
+{
+	atomic_t *nr_dir = d_parent_nr_negative(dentry);
+
+	this_cpu_dec(nr_dentry_negative);
+	percpu_counter_dec(&dentry->d_sb->s_nr_dentry_negative);
+	if (nr_dir)
+		atomic_dec(nr_dir);
+}
+
+/*
+ * The per-directory count is found through d_parent, so a counted dentry
+ * has to take its count along when __d_move() gives it a new parent.
+ * Called with @delta -1 before and +1 after the switch, under d_lock.
+ */
+static void d_negative_move(struct dentry *dentry, int delta)
+{
+	atomic_t *nr_dir;
+
+	if (!d_is_negative(dentry) ||
+	    (dentry->d_flags & (DCACHE_LRU_LIST | DCACHE_SHRINK_LIST)) !=
+	    DCACHE_LRU_LIST)
+		return;
+	nr_dir = d_parent_nr_negative(dentry);
+	if (nr_dir)
+		atomic_add(delta, nr_dir);
+}
+
 static inline void __d_clear_type_and_inode(struct dentry *dentry)
 {
 	unsigned flags = READ_ONCE(dentry->d_flags);
@@ -329,8 +429,9 @@ static inline void __d_clear_type_and_inode(struct dentry *dentry)
 	flags &= ~(DCACHE_ENTRY_TYPE | DCACHE_FALLTHRU);
 	WRITE_ONCE(dentry->d_flags, flags);
 	dentry->d_inode = NULL;
-	if (dentry->d_flags & DCACHE_LRU_LIST)
-		this_cpu_inc(nr_dentry_negative);
+	/* Only dentries on the superblock LRU are counted, see d_lru_add() */
+	if ((flags & (DCACHE_LRU_LIST | DCACHE_SHRINK_LIST)) == DCACHE_LRU_LIST)
+		d_negative_inc(dentry);
 }
 
 static void dentry_free(struct dentry *dentry)
@@ -389,6 +490,8 @@ static void dentry_unlink_inode(struct dentry * dentry)
  * when deleted from or added to the per-superblock LRU list, not
  * from/to the shrink list. That is to avoid an unneeded dec/inc
  * pair when moving from LRU to shrink list in select_collect().
+ * The per-superblock and per-directory negative counts follow the
+ * same rule, through d_negative_inc() and d_negative_dec().
  *
  * These helper functions make sure we always follow the
  * rules. d_lock must be held by the caller.
@@ -400,7 +503,7 @@ static void d_lru_add(struct dentry *dentry)
 	dentry->d_flags |= DCACHE_LRU_LIST;
 	this_cpu_inc(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_inc(nr_dentry_negative);
+		d_negative_inc(dentry);
 	WARN_ON_ONCE(!list_lru_add(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -410,7 +513,7 @@ static void d_lru_del(struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	WARN_ON_ONCE(!list_lru_del(&dentry->d_sb->s_dentry_lru, &dentry->d_lru));
 }
 
@@ -442,7 +545,7 @@ static void d_lru_isolate(struct list_lru_one *lru, struct dentry *dentry)
 	dentry->d_flags &= ~DCACHE_LRU_LIST;
 	this_cpu_dec(nr_dentry_unused);
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate(lru, &dentry->d_lru);
 }
 
@@ -452,7 +555,7 @@ static void d_lru_shrink_move(struct list_lru_one *lru, struct dentry *dentry,
 	D_FLAG_VERIFY(dentry, DCACHE_LRU_LIST);
 	dentry->d_flags |= DCACHE_SHRINK_LIST;
 	if (d_is_negative(dentry))
-		this_cpu_dec(nr_dentry_negative);
+		d_negative_dec(dentry);
 	list_lru_isolate_move(lru, &dentry->d_lru, list);
 }
 
@@ -1225,6 +1328,121 @@ void shrink_dcache_sb(struct super_block *sb)
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
+#define NEGATIVE_DENTRY_TRIM_BATCH	1024
+
+struct negative_dentry_trim {
+	struct list_head dispose;
+	long sb_excess;		/* left to trim to get the sb under limit */
+	unsigned int dir_limit;
+	atomic_long_t *dir_excess;
+	long nr_trimmed;
+};
+
+static enum lru_status dentry_negative_lru_isolate(struct list_head *item,
+		struct list_lru_one *lru, spinlock_t *lru_lock, void *arg)
+{
+	struct negative_dentry_trim *ctl = arg;
+	struct dentry *dentry = container_of(item, struct dentry, d_lru);
+	atomic_t *nr_dir;
+	bool dir_over;
+
+	/* Same lock inversion as in dentry_lru_isolate() */
+	if (!spin_trylock(&dentry->d_lock))
+		return LRU_SKIP;
+
+	if (dentry->d_lockref.count) {
+		d_lru_isolate(lru, dentry);
+		spin_unlock(&dentry->d_lock);
+		return LRU_REMOVED;
+	}
+
+	/*
+	 * Positive dentries are left to the shrinker.  They are rotated rather
+	 * than skipped so that successive batches make progress through the
+	 * list; this costs them the same one extra round a referenced dentry
+	 * gets.
+	 */
+	if (d_is_positive(dentry))
+		goto rotate;
+
+	nr_dir = d_parent_nr_negative(dentry);
+	dir_over = nr_dir &&
+		   d_negative_dir_over(atomic_read(nr_dir), ctl->dir_limit);
+	if (!dir_over && ctl->sb_excess <= 0)
+		goto rotate;
+
+	if (dentry->d_flags & DCACHE_REFERENCED) {
+		dentry->d_flags &= ~DCACHE_REFERENCED;
+		goto rotate;
+	}
+
+	d_lru_shrink_move(lru, dentry, &ctl->dispose);
+	spin_unlock(&dentry->d_lock);
+
+	if (dir_over)
+		atomic_long_dec_if_positive(ctl->dir_excess);
+	ctl->sb_excess--;
+	ctl->nr_trimmed++;
+	return LRU_REMOVED;
+
+rotate:
+	spin_unlock(&dentry->d_lock);
+	return LRU_ROTATE;
+}
+
+/*
+ * Walk the superblock LRU from its cold end and free unused negative dentries
+ * until the superblock is back under its limit (with some slack, so that we
+ * don't get kicked again right away) and the directories that went over
+ * theirs have been trimmed.  Makes at most one pass over the LRU.
+ */
+static void trim_negative_dentries_sb(struct super_block *sb, void *unused)
+{
+	unsigned long sb_limit = READ_ONCE(sysctl_negative_dentry_limit);
+	struct negative_dentry_trim ctl = {
+		.dir_limit = READ_ONCE(sysctl_negative_dentry_dir_limit),
+		.dir_excess = &sb->s_nr_negative_dir_excess,
+	};
+	unsigned long nr_walk;
+	long nr_negative;
+
+	if (!ctl.dir_limit)
+		atomic_long_set(ctl.dir_excess, 0);
+
+	nr_negative = percpu_counter_read_positive(&sb->s_nr_dentry_negative);
+	if (sb_limit && nr_negative > sb_limit) {
+		nr_negative = percpu_counter_sum_positive(&sb->s_nr_dentry_negative);
+		ctl.sb_excess = nr_negative - (sb_limit - sb_limit / 8);
+	}
+	if (ctl.sb_excess <= 0 && !atomic_long_read(ctl.dir_excess))
+		return;
+
+	nr_walk = list_lru_count(&sb->s_dentry_lru);
+	while (nr_walk &&
+	       (ctl.sb_excess > 0 || atomic_long_read(ctl.dir_excess) > 0)) {
+		unsigned long batch = min_t(unsigned long, nr_walk,
+					    NEGATIVE_DENTRY_TRIM_BATCH);
+
+		INIT_LIST_HEAD(&ctl.dispose);
+		list_lru_walk(&sb->s_dentry_lru, dentry_negative_lru_isolate,
+			      &ctl, batch);
+		shrink_dentry_list(&ctl.dispose);
+		nr_walk -= batch;
+		cond_resched();
+	}
+
+	/* A full pass has brought every directory under its limit */
+	if (!nr_walk)
+		atomic_long_set(ctl.dir_excess, 0);
+
+	atomic_long_add(ctl.nr_trimmed, &nr_dentry_negative_trimmed);
+}
+
+static void negative_dentry_trim_workfn(struct work_struct *work)
+{
+	iterate_supers(trim_negative_dentries_sb, NULL);
+}
+
 /**
  * enum d_walk_ret - action to talke during tree walk
  * @D_WALK_CONTINUE:	contrinue walk
@@ -1854,8 +2072,9 @@ static void __d_instantiate(struct dentry *dentry, struct inode *inode)
 	/*
 	 * Decrement negative dentry count if it was in the LRU list.
 	 */
-	if (dentry->d_flags & DCACHE_LRU_LIST)
-		this_cpu_dec(nr_dentry_negative);
+	if ((dentry->d_flags & (DCACHE_LRU_LIST | DCACHE_SHRINK_LIST)) ==
+	    DCACHE_LRU_LIST)
+		d_negative_dec(dentry);
 	hlist_add_head(&dentry->d_u.d_alias, &inode->i_dentry);
 	raw_write_seqcount_begin(&dentry->d_seq);
 	__d_set_inode_and_type(dentry, inode, add_flags);
@@ -2781,6 +3000,10 @@ static void __d_move(struct dentry *dentry, struct dentry *target,
 	if (!d_unhashed(target))
 		___d_drop(target);
 
+	d_negative_move(dentry, -1);
+	if (exchange)
+		d_negative_move(target, -1);
+
 	/* ... and switch them in the tree */
 	dentry->d_parent = target->d_parent;
 	if (!exchange) {
@@ -2801,6 +3024,10 @@ static void __d_move(struct dentry *dentry, struct dentry *target,
 	fsnotify_update_flags(dentry);
 	fscrypt_handle_d_move(dentry);
 
+	d_negative_move(dentry, 1);
+	if (exchange)
+		d_negative_move(target, 1);
+
 	write_seqcount_end(&target->d_seq);
 	write_seqcount_end(&dentry->d_seq);
 
@@ -23,6 +23,7 @@
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
 #include <linux/idr.h>
+#include <linux/mm.h>
 
 static DEFINE_IDA(eventfd_ida);
 
@@ -40,8 +41,24 @@ struct eventfd_ctx {
 	__u64 count;
 	unsigned int flags;
 	int id;
+	/*
+	 * EFD_SHARED_WORD only: a page mapped into userspace whose first
+	 * 32-bit word tells producers whether the consumer is sleeping.
+	 * See include/uapi/linux/eventfd.h.
+	 */
+	u32 *word;
 };
 
+/*
+ * Called with ctx->wqh.lock held after adding to the counter.  The pending
+ * count is a wakeup, so the consumer no longer counts as sleeping.
+ */
+static inline void eventfd_word_wake(struct eventfd_ctx *ctx)
+{
+	if (ctx->word)
+		WRITE_ONCE(*ctx->word, EFD_WORD_AWAKE);
+}
+
 /**
  * eventfd_signal - Adds @n to the eventfd counter.
  * @ctx: [in] Pointer to the eventfd context.
@@ -64,6 +81,7 @@ __u64 eventfd_signal(struct eventfd_ctx *ctx, __u64 n)
 	if (ULLONG_MAX - ctx->count < n)
 		n = ULLONG_MAX - ctx->count;
 	ctx->count += n;
+	eventfd_word_wake(ctx);
 	if (waitqueue_active(&ctx->wqh))
 		wake_up_locked_poll(&ctx->wqh, EPOLLIN);
 	spin_unlock_irqrestore(&ctx->wqh.lock, flags);
@@ -76,6 +94,8 @@ static void eventfd_free_ctx(struct eventfd_ctx *ctx)
 {
 	if (ctx->id >= 0)
 		ida_simple_remove(&eventfd_ida, ctx->id);
+	if (ctx->word)
+		free_page((unsigned long)ctx->word);
 	kfree(ctx);
 }
 
@@ -201,6 +221,12 @@ int eventfd_ctx_remove_wait_queue(struct eventfd_ctx *ctx, wait_queue_entry_t *w
 }
 EXPORT_SYMBOL_GPL(eventfd_ctx_remove_wait_queue);
 
+/*
+ * In EFD_SHARED_WORD mode a blocking read() behaves like FUTEX_WAIT on the
+ * shared word: with the counter at zero it only sleeps while the word reads
+ * EFD_WORD_SLEEPING, and fails with -EAGAIN otherwise.  The userspace side
+ * of the protocol is described in include/uapi/linux/eventfd.h.
+ */
 static ssize_t eventfd_read(struct file *file, char __user *buf, size_t count,
 			    loff_t *ppos)
 {
@@ -224,6 +250,11 @@ static ssize_t eventfd_read(struct file *file, char __user *buf, size_t count,
 				res = sizeof(ucnt);
 				break;
 			}
+			if (ctx->word &&
+			    READ_ONCE(*ctx->word) != EFD_WORD_SLEEPING) {
+				res = -EAGAIN;
+				break;
+			}
 			if (signal_pending(current)) {
 				res = -ERESTARTSYS;
 				break;
@@ -287,6 +318,7 @@ static ssize_t eventfd_write(struct file *file, const char __user *buf, size_t c
 	}
 	if (likely(res > 0)) {
 		ctx->count += ucnt;
+		eventfd_word_wake(ctx);
 		if (waitqueue_active(&ctx->wqh))
 			wake_up_locked_poll(&ctx->wqh, EPOLLIN);
 	}
@@ -295,6 +327,20 @@ static ssize_t eventfd_write(struct file *file, const char __user *buf, size_t c
 	return res;
 }
 
+static int eventfd_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct eventfd_ctx *ctx = file->private_data;
+
+	if (!ctx->word)
+		return -ENODEV;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE ||
+	    !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;
+
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(ctx->word));
+}
+
 #ifdef CONFIG_PROC_FS
 static void eventfd_show_fdinfo(struct seq_file *m, struct file *f)
 {
@@ -316,6 +362,7 @@ static const struct file_operations eventfd_fops = {
 	.poll		= eventfd_poll,
 	.read		= eventfd_read,
 	.write		= eventfd_write,
+	.mmap		= eventfd_mmap,
 	.llseek		= noop_llseek,
 };
 
@@ -409,6 +456,14 @@ static int do_eventfd(unsigned int count, int flags)
 	ctx->count = count;
 	ctx->flags = flags;
 	ctx->id = ida_simple_get(&eventfd_ida, 0, 0, GFP_KERNEL);
+	ctx->word = NULL;
+	if (flags & EFD_SHARED_WORD) {
+		ctx->word = (u32 *)get_zeroed_page(GFP_KERNEL_ACCOUNT);
+		if (!ctx->word) {
+			eventfd_free_ctx(ctx);
+			return -ENOMEM;
+		}
+	}
 
 	fd = anon_inode_getfd("[eventfd]", &eventfd_fops, ctx,
 			      O_RDWR | (flags & EFD_SHARED_FCNTL_FLAGS));
@@ -17,6 +17,8 @@ struct mnt_namespace {
 	u64 event;
 	unsigned int		mounts; /* # of mounts in the namespace */
 	unsigned int		pending_mounts;
+	/* Protects the list against /proc/mounts cursors moving in it */
+	spinlock_t		ns_lock;
 } __randomize_layout;
 
 struct mnt_pcp {
@@ -131,12 +133,17 @@ struct proc_mounts {
 	struct mnt_namespace *ns;
 	struct path root;
 	int (*show)(struct seq_file *, struct vfsmount *);
-	void *cached_mount;
-	u64 cached_event;
-	loff_t cached_index;
+	/* Marks where the last read() stopped in ns->list */
+	struct mount cursor;
 };
 
 extern const struct seq_operations mounts_op;
+extern void mnt_cursor_del(struct mnt_namespace *ns, struct mount *cursor);
+
+static inline bool mnt_is_cursor(struct mount *mnt)
+{
+	return mnt->mnt.mnt_flags & MNT_CURSOR;
+}
 
 extern bool __is_local_mountpoint(struct dentry *dentry);
 static inline bool is_local_mountpoint(struct dentry *dentry)
@@ -82,11 +82,15 @@ struct nfs_client_initdata {
 	struct nfs_subversion *nfs_mod;
 	int proto;
 	u32 minorversion;
+	unsigned int nconnect;
 	struct net *net;
 	const struct rpc_timeout *timeparms;
 	const struct cred *cred;
 };
 
+/* Maximum number of transport connections per nfs_client */
+#define NFS_MAX_CONNECTIONS 16
+
 /*
  * In-kernel mount arguments
  */
@@ -123,6 +127,7 @@ struct nfs_parsed_mount_data {
 		char			*export_path;
 		int			port;
 		unsigned short		protocol;
+		unsigned short		nconnect;
 	} nfs_server;
 
 	void			*lsm_opts;
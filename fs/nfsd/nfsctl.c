@@ -23,6 +23,7 @@
 #include "state.h"
 #include "netns.h"
 #include "pnfs.h"
+#include "filecache.h"
 
 /*
  *	We have a single directory with several nodes in it.
@@ -38,6 +39,7 @@ enum {
 	NFSD_Pool_Threads,
 	NFSD_Pool_Stats,
 	NFSD_Reply_Cache_Stats,
+	NFSD_File_Cache_Stats,
 	NFSD_Versions,
 	NFSD_Ports,
 	NFSD_MaxBlkSize,
@@ -225,6 +227,13 @@ static const struct file_operations reply_cache_stats_operations = {
 	.release	= single_release,
 };
 
+static const struct file_operations filecache_ops = {
+	.open		= nfsd_file_cache_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 /*----------------------------------------------------------------------------*/
 /*
  * payload - write methods
@@ -320,6 +329,15 @@ static ssize_t write_unlock_fs(struct file *file, char *buf, size_t size)
 	 */
 	error = nlmsvc_unlock_all_by_sb(path.dentry->d_sb);
 
+	/*
+	 * Cached open files would keep the filesystem busy and make the
+	 * following umount fail. The cache isn't indexed by superblock, so
+	 * just drop everything for this namespace.
+	 */
+	mutex_lock(&nfsd_mutex);
+	nfsd_file_cache_purge(netns(file));
+	mutex_unlock(&nfsd_mutex);
+
 	path_put(&path);
 	return error;
 }
@@ -1162,6 +1180,7 @@ static int nfsd_fill_super(struct super_block * sb, void * data, int silent)
 		[NFSD_Pool_Threads] = {"pool_threads", &transaction_ops, S_IWUSR|S_IRUSR},
 		[NFSD_Pool_Stats] = {"pool_stats", &pool_stats_operations, S_IRUGO},
 		[NFSD_Reply_Cache_Stats] = {"reply_cache_stats", &reply_cache_stats_operations, S_IRUGO},
+		[NFSD_File_Cache_Stats] = {"filecache", &filecache_ops, S_IRUGO},
 		[NFSD_Versions] = {"versions", &transaction_ops, S_IWUSR|S_IRUSR},
 		[NFSD_Ports] = {"portlist", &transaction_ops, S_IWUSR|S_IRUGO},
 		[NFSD_MaxBlkSize] = {"max_block_size", &transaction_ops, S_IWUSR|S_IRUGO},
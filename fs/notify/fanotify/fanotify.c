@@ -11,6 +11,7 @@
 #include <linux/sched/signal.h>
 #include <linux/types.h>
 #include <linux/wait.h>
+#include <linux/hash.h>
 #include <linux/audit.h>
 #include <linux/sched/mm.h>
 #include <linux/statfs.h>
@@ -50,11 +51,33 @@ static bool should_merge(struct fsnotify_event *old_fsn,
 	return false;
 }
 
+/*
+ * The bucket only depends on fields that should_merge() compares for
+ * equality, so all merge candidates of an event share its bucket.
+ */
+static unsigned int fanotify_event_hash(struct fanotify_event *event)
+{
+	unsigned long key = (unsigned long)event->fse.inode ^
+			    (unsigned long)event->pid ^ event->fh_type;
+
+	return hash_long(key, FANOTIFY_HTABLE_BITS);
+}
+
+static void fanotify_event_hash_add(struct fsnotify_group *group,
+				    struct fanotify_event *event)
+{
+	hlist_add_head(&event->merge_list,
+		       &group->fanotify_data.merge_hash[event->hash]);
+}
+
 /* and the list better be locked by something too! */
 static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 {
-	struct fsnotify_event *test_event;
-	struct fanotify_event *new;
+	struct fsnotify_group *group = container_of(list, struct fsnotify_group,
+						    notification_list);
+	struct fsnotify_event *first;
+	struct fanotify_event *old, *new;
+	int i = 0;
 
 	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
 	new = FANOTIFY_E(event);
@@ -67,13 +90,30 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	if (fanotify_is_perm_event(new->mask))
 		return 0;
 
-	list_for_each_entry_reverse(test_event, list, list) {
-		if (should_merge(test_event, event)) {
-			FANOTIFY_E(test_event)->mask |= new->mask;
+	/*
+	 * We are not called for an event queued on an empty list, so the
+	 * event at the head of the queue may not have been indexed yet. It
+	 * is the only one that can be missing.
+	 */
+	first = list_first_entry(list, struct fsnotify_event, list);
+	if (first != group->overflow_event &&
+	    hlist_unhashed(&FANOTIFY_E(first)->merge_list) &&
+	    !fanotify_is_perm_event(FANOTIFY_E(first)->mask))
+		fanotify_event_hash_add(group, FANOTIFY_E(first));
+
+	/* Most recently queued events come first in the bucket */
+	hlist_for_each_entry(old, &group->fanotify_data.merge_hash[new->hash],
+			     merge_list) {
+		if (++i > FANOTIFY_MAX_MERGE_EVENTS)
+			break;
+		if (should_merge(&old->fse, event)) {
+			old->mask |= new->mask;
 			return 1;
 		}
 	}
 
+	/* fsnotify_add_event() is going to queue the event */
+	fanotify_event_hash_add(group, new);
 	return 0;
 }
 
@@ -330,6 +370,8 @@ init: __maybe_unused
 		event->path.mnt = NULL;
 		event->path.dentry = NULL;
 	}
+	INIT_HLIST_NODE(&event->merge_list);
+	event->hash = fanotify_event_hash(event);
 out:
 	memalloc_unuse_memcg();
 	return event;
@@ -462,6 +504,7 @@ static void fanotify_free_group_priv(struct fsnotify_group *group)
 {
 	struct user_struct *user;
 
+	kfree(group->fanotify_data.merge_hash);
 	user = group->fanotify_data.user;
 	atomic_dec(&user->fanotify_listeners);
 	free_uid(user);
@@ -53,6 +53,17 @@ static inline bool fanotify_fid_equal(struct fanotify_fid *fid1,
 			fanotify_fid_fh(fid2, fh_len), fh_len);
 }
 
+/*
+ * Queued events are also indexed in a per-group hash table, keyed by the
+ * fields that should_merge() requires to be equal, so that finding a merge
+ * candidate does not need to walk the whole notification queue. The walk of
+ * a single bucket is bounded as well, so merging stays O(1) no matter how
+ * far behind the listener is.
+ */
+#define FANOTIFY_HTABLE_BITS	10
+#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
+#define FANOTIFY_MAX_MERGE_EVENTS	128
+
 /*
  * Structure for normal fanotify events. It gets allocated in
  * fanotify_handle_event() and freed when the information is retrieved by
@@ -60,6 +71,7 @@ static inline bool fanotify_fid_equal(struct fanotify_fid *fid1,
  */
 struct fanotify_event {
 	struct fsnotify_event fse;
+	struct hlist_node merge_list;	/* in group merge_hash */
 	u32 mask;
 	/*
 	 * Those fields are outside fanotify_fid to pack fanotify_event nicely
@@ -69,7 +81,7 @@ struct fanotify_event {
 	 */
 	u8 fh_type;
 	u8 fh_len;
-	u16 pad;
+	u16 hash;	/* merge_hash bucket */
 	union {
 		/*
 		 * We hold ref to this path so it may be dereferenced at any
@@ -139,6 +151,15 @@ static inline struct fanotify_event *FANOTIFY_E(struct fsnotify_event *fse)
 	return container_of(fse, struct fanotify_event, fse);
 }
 
+/*
+ * Drop an event that was just removed from the notification queue from the
+ * merge hash. Must be called with group->notification_lock held.
+ */
+static inline void fanotify_event_unhash(struct fsnotify_event *fse)
+{
+	hlist_del_init(&FANOTIFY_E(fse)->merge_list);
+}
+
 struct fanotify_event *fanotify_alloc_event(struct fsnotify_group *group,
 					    struct inode *inode, u32 mask,
 					    const void *data, int data_type,
@@ -89,6 +89,7 @@ static struct fsnotify_event *get_one_event(struct fsnotify_group *group,
 		goto out;
 	}
 	fsn_event = fsnotify_remove_first_event(group);
+	fanotify_event_unhash(fsn_event);
 	if (fanotify_is_perm_event(FANOTIFY_E(fsn_event)->mask))
 		FANOTIFY_PE(fsn_event)->state = FAN_EVENT_REPORTED;
 out:
@@ -470,6 +471,7 @@ static int fanotify_release(struct inode *ignored, struct file *file)
 	 */
 	while (!fsnotify_notify_queue_is_empty(group)) {
 		fsn_event = fsnotify_remove_first_event(group);
+		fanotify_event_unhash(fsn_event);
 		if (!(FANOTIFY_E(fsn_event)->mask & FANOTIFY_PERM_EVENTS)) {
 			spin_unlock(&group->notification_lock);
 			fsnotify_destroy_event(group, fsn_event);
@@ -755,6 +757,22 @@ static int fanotify_add_inode_mark(struct fsnotify_group *group,
 }
 
 /* fanotify syscalls */
+static struct hlist_head *fanotify_alloc_merge_hash(void)
+{
+	struct hlist_head *hash;
+	int i;
+
+	hash = kmalloc_array(FANOTIFY_HTABLE_SIZE, sizeof(struct hlist_head),
+			     GFP_KERNEL_ACCOUNT);
+	if (!hash)
+		return NULL;
+
+	for (i = 0; i < FANOTIFY_HTABLE_SIZE; i++)
+		INIT_HLIST_HEAD(&hash[i]);
+
+	return hash;
+}
+
 SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 {
 	struct fsnotify_group *group;
@@ -815,6 +833,12 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 	atomic_inc(&user->fanotify_listeners);
 	group->memcg = get_mem_cgroup_from_mm(current->mm);
 
+	group->fanotify_data.merge_hash = fanotify_alloc_merge_hash();
+	if (!group->fanotify_data.merge_hash) {
+		fd = -ENOMEM;
+		goto out_destroy_group;
+	}
+
 	oevent = fanotify_alloc_event(group, NULL, FS_Q_OVERFLOW, NULL,
 				      FSNOTIFY_EVENT_NONE, NULL);
 	if (unlikely(!oevent)) {
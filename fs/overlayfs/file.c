@@ -293,10 +293,14 @@ static ssize_t ovl_write_iter(struct kiocb *iocb, struct iov_iter *iter)
 
 static int ovl_fsync(struct file *file, loff_t start, loff_t end, int datasync)
 {
+	struct ovl_fs *ofs = file_inode(file)->i_sb->s_fs_info;
 	struct fd real;
 	const struct cred *old_cred;
 	int ret;
 
+	if (!ovl_should_sync(ofs))
+		return 0;
+
 	ret = ovl_real_fdget_meta(file, &real, !datasync);
 	if (ret)
 		return ret;
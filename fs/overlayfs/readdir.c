@@ -819,10 +819,11 @@ static int ovl_dir_fsync(struct file *file, loff_t start, loff_t end,
 {
 	struct ovl_dir_file *od = file->private_data;
 	struct dentry *dentry = file->f_path.dentry;
+	struct ovl_fs *ofs = dentry->d_sb->s_fs_info;
 	struct file *realfile = od->realfile;
 
-	/* Nothing to sync for lower */
-	if (!OVL_TYPE_UPPER(ovl_path_type(dentry)))
+	/* Nothing to sync for lower or volatile upper */
+	if (!OVL_TYPE_UPPER(ovl_path_type(dentry)) || !ovl_should_sync(ofs))
 		return 0;
 
 	/*
@@ -1013,7 +1014,7 @@ int ovl_check_d_type_supported(struct path *realpath)
 	return rdd.d_type_supported;
 }
 
-static void ovl_workdir_cleanup_recurse(struct path *path, int level)
+static int ovl_workdir_cleanup_recurse(struct path *path, int level)
 {
 	int err;
 	struct inode *dir = path->dentry->d_inode;
@@ -1027,6 +1028,16 @@ static void ovl_workdir_cleanup_recurse(struct path *path, int level)
 		.root = &root,
 		.is_lowest = false,
 	};
+	bool incompat = false;
+
+	/*
+	 * The "work/incompat" directory is treated specially - if it is not
+	 * empty, instead of cleaning it up, we error about incompat features
+	 * and fail the mount.
+	 */
+	if (level == 2 &&
+	    !strcmp(path->dentry->d_name.name, OVL_INCOMPATDIR_NAME))
+		incompat = true;
 
 	err = ovl_dir_read(path, &rdd);
 	if (err)
@@ -1042,26 +1053,40 @@ static void ovl_workdir_cleanup_recurse(struct path *path, int level)
 			if (p->len == 2 && p->name[1] == '.')
 				continue;
 		}
+		if (incompat) {
+			pr_err("overlayfs: overlay with incompat feature '%s' cannot be mounted\n",
+			       p->name);
+			err = -EINVAL;
+			break;
+		}
 		dentry = lookup_one_len(p->name, path->dentry, p->len);
 		if (IS_ERR(dentry))
 			continue;
 		if (dentry->d_inode)
-			ovl_workdir_cleanup(dir, path->mnt, dentry, level);
+			err = ovl_workdir_cleanup(dir, path->mnt, dentry, level);
 		dput(dentry);
+		if (err == -EINVAL)
+			break;
+		err = 0;
 	}
 	inode_unlock(dir);
 out:
 	ovl_cache_free(&list);
+	return err;
 }
 
-void ovl_workdir_cleanup(struct inode *dir, struct vfsmount *mnt,
-			 struct dentry *dentry, int level)
+/*
+ * Returns -EINVAL if the workdir contains an incompat feature marker, in which
+ * case the caller must fail the mount; all other errors are ignored.
+ */
+int ovl_workdir_cleanup(struct inode *dir, struct vfsmount *mnt,
+			struct dentry *dentry, int level)
 {
 	int err;
 
 	if (!d_is_dir(dentry) || level > 1) {
 		ovl_cleanup(dir, dentry);
-		return;
+		return 0;
 	}
 
 	err = ovl_do_rmdir(dir, dentry);
@@ -1069,10 +1094,14 @@ void ovl_workdir_cleanup(struct inode *dir, struct vfsmount *mnt,
 		struct path path = { .mnt = mnt, .dentry = dentry };
 
 		inode_unlock(dir);
-		ovl_workdir_cleanup_recurse(&path, level + 1);
+		err = ovl_workdir_cleanup_recurse(&path, level + 1);
 		inode_lock_nested(dir, I_MUTEX_PARENT);
+		if (err == -EINVAL)
+			return err;
 		ovl_cleanup(dir, dentry);
 	}
+
+	return 0;
 }
 
 int ovl_indexdir_cleanup(struct ovl_fs *ofs)
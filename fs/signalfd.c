@@ -163,11 +163,49 @@ static int signalfd_copyinfo(struct signalfd_siginfo __user *uinfo,
 	return sizeof(*uinfo);
 }
 
+/*
+ * A task blocked in signalfd_dequeue().  All signalfd readers of a thread
+ * group share sighand->signalfd_wqh, so every signal sent to any thread
+ * wakes every one of them.  Only wake a reader when a signal it can
+ * dequeue is pending; the others would just go back to sleep.
+ */
+struct signalfd_wait {
+	wait_queue_entry_t wq_entry;
+	struct signalfd_ctx *ctx;
+};
+
+static bool signalfd_deliverable(struct task_struct *p, sigset_t *mask)
+{
+	sigset_t pending;
+
+	sigandnsets(&pending, &p->pending.signal, mask);
+	if (!sigisemptyset(&pending))
+		return true;
+	sigandnsets(&pending, &p->signal->shared_pending.signal, mask);
+	return !sigisemptyset(&pending);
+}
+
+/*
+ * Called with the reader's sighand->siglock held, except for POLLFREE
+ * from signalfd_cleanup() which must always get through.
+ */
+static int signalfd_wake_function(wait_queue_entry_t *wq_entry,
+				  unsigned int mode, int sync, void *key)
+{
+	struct signalfd_wait *wait = container_of(wq_entry,
+					struct signalfd_wait, wq_entry);
+
+	if (!(key_to_poll(key) & POLLFREE) &&
+	    !signalfd_deliverable(wq_entry->private, &wait->ctx->sigmask))
+		return 0;
+	return default_wake_function(wq_entry, mode, sync, key);
+}
+
 static ssize_t signalfd_dequeue(struct signalfd_ctx *ctx, kernel_siginfo_t *info,
 				int nonblock)
 {
 	ssize_t ret;
-	DECLARE_WAITQUEUE(wait, current);
+	struct signalfd_wait wait;
 
 	spin_lock_irq(&current->sighand->siglock);
 	ret = dequeue_signal(current, &ctx->sigmask, info);
@@ -182,7 +220,10 @@ static ssize_t signalfd_dequeue(struct signalfd_ctx *ctx, kernel_siginfo_t *info
 		return ret;
 	}
 
-	add_wait_queue(&current->sighand->signalfd_wqh, &wait);
+	init_waitqueue_func_entry(&wait.wq_entry, signalfd_wake_function);
+	wait.wq_entry.private = current;
+	wait.ctx = ctx;
+	add_wait_queue(&current->sighand->signalfd_wqh, &wait.wq_entry);
 	for (;;) {
 		set_current_state(TASK_INTERRUPTIBLE);
 		ret = dequeue_signal(current, &ctx->sigmask, info);
@@ -198,7 +239,7 @@ static ssize_t signalfd_dequeue(struct signalfd_ctx *ctx, kernel_siginfo_t *info
 	}
 	spin_unlock_irq(&current->sighand->siglock);
 
-	remove_wait_queue(&current->sighand->signalfd_wqh, &wait);
+	remove_wait_queue(&current->sighand->signalfd_wqh, &wait.wq_entry);
 	__set_current_state(TASK_RUNNING);
 
 	return ret;
@@ -300,9 +341,9 @@ static int do_signalfd4(int ufd, sigset_t *mask, int flags)
 		}
 		spin_lock_irq(&current->sighand->siglock);
 		ctx->sigmask = *mask;
-		spin_unlock_irq(&current->sighand->siglock);
-
+		/* Under siglock, for signalfd_wake_function() */
 		wake_up(&current->sighand->signalfd_wqh);
+		spin_unlock_irq(&current->sighand->siglock);
 		fdput(f);
 	}
 
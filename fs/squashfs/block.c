@@ -66,6 +66,28 @@ static struct buffer_head *get_block_length(struct super_block *sb,
 }
 
 
+/*
+ * Start reading the device blocks holding a datablock without waiting for
+ * them.  A following squashfs_read_data() of the datablock then finds the
+ * buffers uptodate or in flight, so readahead can have the reads for all of
+ * its datablocks outstanding at once rather than one block at a time.
+ */
+void squashfs_readahead_data(struct super_block *sb, u64 index, int length)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	u64 cur_index = index >> msblk->devblksize_log2;
+	u64 end_index;
+
+	length = SQUASHFS_COMPRESSED_SIZE_BLOCK(length);
+	if (length <= 0 || (index + length) > msblk->bytes_used)
+		return;
+
+	end_index = (index + length - 1) >> msblk->devblksize_log2;
+	for (; cur_index <= end_index; cur_index++)
+		sb_breadahead(sb, cur_index);
+}
+
+
 /*
  * Read and decompress a metadata block or datablock.  Length is non-zero
  * if a datablock is being read (the size is stored elsewhere in the
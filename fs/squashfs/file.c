@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/blkdev.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -494,7 +495,124 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+/*
+ * Readahead.  The window is handled a datablock at a time, but the block
+ * list is looked up and the device reads are started for every datablock
+ * in the window before any of them is decompressed, so that the I/O for
+ * the whole window is in flight together.  Each datablock is then
+ * decompressed straight into the page cache pages covering it.
+ *
+ * The tail-end fragment and sparse blocks are left to squashfs_readpage().
+ */
+struct squashfs_ra_block {
+	int	index;
+	int	bsize;
+	u64	block;
+};
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned int nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	int mask = (1 << shift) - 1;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	int last_page = (i_size_read(inode) - 1) >> PAGE_SHIFT;
+	struct squashfs_ra_block *ra;
+	struct page **page, *p;
+	struct blk_plug plug;
+	int i, n, nr_blocks = 0, max_blocks;
+
+	if (list_empty(pages))
+		return 0;
+
+	max_blocks = (list_first_entry(pages, struct page, lru)->index >> shift) -
+		(lru_to_page(pages)->index >> shift) + 1;
+
+	ra = kmalloc_array(max_blocks, sizeof(*ra), GFP_KERNEL);
+	page = kmalloc_array(mask + 1, sizeof(void *), GFP_KERNEL);
+	if (ra == NULL || page == NULL)
+		goto out;
+
+	/* The list is in descending index order, so walk it backwards */
+	blk_start_plug(&plug);
+	list_for_each_entry_reverse(p, pages, lru) {
+		int index = p->index >> shift;
+		u64 block = 0;
+		int bsize;
+
+		if (nr_blocks && ra[nr_blocks - 1].index == index)
+			continue;
+
+		if (index == file_end && squashfs_i(inode)->fragment_block !=
+						SQUASHFS_INVALID_BLK)
+			break;
+
+		bsize = read_blocklist(inode, index, &block);
+		if (bsize <= 0)
+			break;
+
+		squashfs_readahead_data(inode->i_sb, block, bsize);
+		ra[nr_blocks].index = index;
+		ra[nr_blocks].block = block;
+		ra[nr_blocks].bsize = bsize;
+		if (++nr_blocks == max_blocks)
+			break;
+	}
+	blk_finish_plug(&plug);
+
+	for (i = 0; i < nr_blocks; i++) {
+		int start_index = ra[i].index << shift;
+		int end_index = min(start_index | mask, last_page);
+		int expected = ra[i].index == file_end ?
+			(i_size_read(inode) & (msblk->block_size - 1)) :
+			 msblk->block_size;
+
+		n = end_index - start_index + 1;
+		memset(page, 0, n * sizeof(void *));
+
+		/* Insert the pages readahead allocated for this block */
+		while (!list_empty(pages)) {
+			p = lru_to_page(pages);
+			if (p->index > end_index)
+				break;
+
+			list_del(&p->lru);
+			if (add_to_page_cache_lru(p, mapping, p->index,
+					readahead_gfp_mask(mapping))) {
+				put_page(p);
+				continue;
+			}
+			page[p->index - start_index] = p;
+		}
+
+		/* And grab the rest of the block if it isn't cached */
+		for (n = 0; n <= end_index - start_index; n++) {
+			if (page[n])
+				continue;
+
+			page[n] = grab_cache_page_nowait(mapping,
+							 start_index + n);
+			if (page[n] && PageUptodate(page[n])) {
+				unlock_page(page[n]);
+				put_page(page[n]);
+				page[n] = NULL;
+			}
+		}
+
+		squashfs_readahead_block(inode, page, n, ra[i].block,
+					 ra[i].bsize, expected);
+	}
+
+out:
+	kfree(page);
+	kfree(ra);
+	return 0;
+}
+
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
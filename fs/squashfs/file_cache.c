@@ -34,3 +34,34 @@ int squashfs_readpage_block(struct page *page, u64 block, int bsize, int expecte
 	squashfs_cache_put(buffer);
 	return res;
 }
+
+/* Read a datablock for readahead and memcopy it into the page cache */
+int squashfs_readahead_block(struct inode *inode, struct page **page,
+	int pages, u64 block, int bsize, int expected)
+{
+	struct squashfs_cache_entry *buffer = squashfs_get_datablock(
+						inode->i_sb, block, bsize);
+	int res = buffer->error, n, offset = 0;
+
+	if (res)
+		ERROR("Unable to read page, block %llx, size %x\n", block,
+			bsize);
+
+	for (n = 0; n < pages; n++, expected -= PAGE_SIZE,
+			offset += PAGE_SIZE) {
+		int avail = clamp_t(int, expected, 0, PAGE_SIZE);
+
+		if (page[n] == NULL)
+			continue;
+
+		if (res)
+			SetPageError(page[n]);
+		else
+			squashfs_fill_page(page[n], buffer, offset, avail);
+		unlock_page(page[n]);
+		put_page(page[n]);
+	}
+
+	squashfs_cache_put(buffer);
+	return res;
+}
@@ -18,61 +18,22 @@
 #include "squashfs.h"
 #include "page_actor.h"
 
-static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
-	int pages, struct page **page, int bytes);
-
-/* Read separately compressed datablock directly into page cache */
-int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
-	int expected)
+static int squashfs_read_cache(struct inode *inode, struct page *target_page,
+	u64 block, int bsize, int pages, struct page **page, int bytes);
 
+/*
+ * Decompress the datablock @block into the locked page cache pages
+ * @page[0..pages-1].  Pages other than @target_page are unlocked and
+ * released; @target_page is left to the caller on error.
+ */
+static int squashfs_read_block_pages(struct inode *inode,
+	struct page *target_page, struct page **page, int pages,
+	int missing_pages, u64 block, int bsize, int expected)
 {
-	struct inode *inode = target_page->mapping->host;
-	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
-
-	int file_end = (i_size_read(inode) - 1) >> PAGE_SHIFT;
-	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
-	int start_index = target_page->index & ~mask;
-	int end_index = start_index | mask;
-	int i, n, pages, missing_pages, bytes, res = -ENOMEM;
-	struct page **page;
 	struct squashfs_page_actor *actor;
+	int i, bytes, res;
 	void *pageaddr;
 
-	if (end_index > file_end)
-		end_index = file_end;
-
-	pages = end_index - start_index + 1;
-
-	page = kmalloc_array(pages, sizeof(void *), GFP_KERNEL);
-	if (page == NULL)
-		return res;
-
-	/*
-	 * Create a "page actor" which will kmap and kunmap the
-	 * page cache pages appropriately within the decompressor
-	 */
-	actor = squashfs_page_actor_init_special(page, pages, 0);
-	if (actor == NULL)
-		goto out;
-
-	/* Try to grab all the pages covered by the Squashfs block */
-	for (missing_pages = 0, i = 0, n = start_index; i < pages; i++, n++) {
-		page[i] = (n == target_page->index) ? target_page :
-			grab_cache_page_nowait(target_page->mapping, n);
-
-		if (page[i] == NULL) {
-			missing_pages++;
-			continue;
-		}
-
-		if (PageUptodate(page[i])) {
-			unlock_page(page[i]);
-			put_page(page[i]);
-			page[i] = NULL;
-			missing_pages++;
-		}
-	}
-
 	if (missing_pages) {
 		/*
 		 * Couldn't get one or more pages, this page has either
@@ -81,16 +42,26 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 		 * squashfs_readpage also trying to grab them.  Fall back to
 		 * using an intermediate buffer.
 		 */
-		res = squashfs_read_cache(target_page, block, bsize, pages,
-							page, expected);
+		res = squashfs_read_cache(inode, target_page, block, bsize,
+							pages, page, expected);
 		if (res < 0)
 			goto mark_errored;
 
-		goto out;
+		return 0;
 	}
 
+	/*
+	 * Create a "page actor" which will kmap and kunmap the
+	 * page cache pages appropriately within the decompressor
+	 */
+	res = -ENOMEM;
+	actor = squashfs_page_actor_init_special(page, pages, 0);
+	if (actor == NULL)
+		goto mark_errored;
+
 	/* Decompress directly into the page cache buffers */
 	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+	kfree(actor);
 	if (res < 0)
 		goto mark_errored;
 
@@ -116,9 +87,6 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 			put_page(page[i]);
 	}
 
-	kfree(actor);
-	kfree(page);
-
 	return 0;
 
 mark_errored:
@@ -134,19 +102,82 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 		put_page(page[i]);
 	}
 
-out:
-	kfree(actor);
+	return res;
+}
+
+/* Read separately compressed datablock directly into page cache */
+int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
+	int expected)
+
+{
+	struct inode *inode = target_page->mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+
+	int file_end = (i_size_read(inode) - 1) >> PAGE_SHIFT;
+	int mask = (1 << (msblk->block_log - PAGE_SHIFT)) - 1;
+	int start_index = target_page->index & ~mask;
+	int end_index = start_index | mask;
+	int i, n, pages, missing_pages, res;
+	struct page **page;
+
+	if (end_index > file_end)
+		end_index = file_end;
+
+	pages = end_index - start_index + 1;
+
+	page = kmalloc_array(pages, sizeof(void *), GFP_KERNEL);
+	if (page == NULL)
+		return -ENOMEM;
+
+	/* Try to grab all the pages covered by the Squashfs block */
+	for (missing_pages = 0, i = 0, n = start_index; i < pages; i++, n++) {
+		page[i] = (n == target_page->index) ? target_page :
+			grab_cache_page_nowait(target_page->mapping, n);
+
+		if (page[i] == NULL) {
+			missing_pages++;
+			continue;
+		}
+
+		if (PageUptodate(page[i])) {
+			unlock_page(page[i]);
+			put_page(page[i]);
+			page[i] = NULL;
+			missing_pages++;
+		}
+	}
+
+	res = squashfs_read_block_pages(inode, target_page, page, pages,
+					missing_pages, block, bsize, expected);
+
 	kfree(page);
 	return res;
 }
 
+/*
+ * Readahead of a whole datablock: @page holds the locked pages covering
+ * the block, with NULL for pages that are already uptodate or could not
+ * be grabbed.  All pages are unlocked and released.
+ */
+int squashfs_readahead_block(struct inode *inode, struct page **page,
+	int pages, u64 block, int bsize, int expected)
+{
+	int i, missing_pages = 0;
+
+	for (i = 0; i < pages; i++)
+		if (page[i] == NULL)
+			missing_pages++;
+
+	return squashfs_read_block_pages(inode, NULL, page, pages,
+					 missing_pages, block, bsize, expected);
+}
+
 
-static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
-	int pages, struct page **page, int bytes)
+static int squashfs_read_cache(struct inode *inode, struct page *target_page,
+	u64 block, int bsize, int pages, struct page **page, int bytes)
 {
-	struct inode *i = target_page->mapping->host;
-	struct squashfs_cache_entry *buffer = squashfs_get_datablock(i->i_sb,
-						 block, bsize);
+	struct squashfs_cache_entry *buffer = squashfs_get_datablock(
+						inode->i_sb, block, bsize);
 	int res = buffer->error, n, offset = 0;
 
 	if (res) {
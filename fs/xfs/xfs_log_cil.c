@@ -384,6 +384,11 @@ xlog_cil_insert_format_items(
  * if the change requires additional log metadata. If it does, take that space
  * as well. Remove the amount of space we added to the checkpoint ticket from
  * the current transaction ticket so that the accounting works out correctly.
+ *
+ * All of the CIL state modified here lives in the per-cpu xlog_cil_pcp of the
+ * CPU we are running on, so concurrent transaction commits don't contend on
+ * anything but the shared xc_ctx_lock. The push aggregates the per-cpu state
+ * into the checkpoint context.
  */
 static void
 xlog_cil_insert_items(
@@ -392,11 +397,14 @@ xlog_cil_insert_items(
 {
 	struct xfs_cil		*cil = log->l_cilp;
 	struct xfs_cil_ctx	*ctx = cil->xc_ctx;
+	struct xlog_cil_pcp	*cilpcp;
 	struct xfs_log_item	*lip;
 	int			len = 0;
 	int			diff_iovecs = 0;
 	int			iclog_space;
+	int			space_used;
 	int			iovhdr_res = 0, split_res = 0, ctx_res = 0;
+	uint32_t		order;
 
 	ASSERT(tp);
 
@@ -406,16 +414,9 @@ xlog_cil_insert_items(
 	 */
 	xlog_cil_insert_format_items(log, tp, &len, &diff_iovecs);
 
-	spin_lock(&cil->xc_cil_lock);
-
 	/* account for space used by new iovec headers  */
 	iovhdr_res = diff_iovecs * sizeof(xlog_op_header_t);
 	len += iovhdr_res;
-	ctx->nvecs += diff_iovecs;
-
-	/* attach the transaction to the CIL if it has any busy extents */
-	if (!list_empty(&tp->t_busy))
-		list_splice_init(&tp->t_busy, &ctx->busy_extents);
 
 	/*
 	 * Now transfer enough transaction reservation to the context ticket
@@ -423,67 +424,98 @@ xlog_cil_insert_items(
 	 * reservation has to grow as well as the current reservation as we
 	 * steal from tickets so we can correctly determine the space used
 	 * during the transaction commit.
+	 *
+	 * The first commit into the context takes the unit reservation. Test
+	 * the bit before clearing it so that the common case doesn't have to
+	 * do a locked atomic operation. The bit can only be set again by the
+	 * push, which holds the xc_ctx_lock exclusively.
 	 */
-	if (ctx->ticket->t_curr_res == 0) {
+	if (test_bit(XLOG_CIL_EMPTY, &cil->xc_flags) &&
+	    test_and_clear_bit(XLOG_CIL_EMPTY, &cil->xc_flags))
 		ctx_res = ctx->ticket->t_unit_res;
-		ctx->ticket->t_curr_res = ctx_res;
-		tp->t_ticket->t_curr_res -= ctx_res;
-	}
 
-	/* do we need space for more log record headers? */
+	cilpcp = get_cpu_ptr(cil->xc_pcp);
+	cilpcp->nvecs += diff_iovecs;
+
+	/* attach the transaction to the CIL if it has any busy extents */
+	if (!list_empty(&tp->t_busy))
+		list_splice_init(&tp->t_busy, &cilpcp->busy_extents);
+
+	/*
+	 * Do we need space for more log record headers? We only know how much
+	 * this CPU has added to the checkpoint, so treat each CPU's share as a
+	 * separate run of iclogs that needs a header of its own when it starts.
+	 * The very first run is covered by the unit reservation taken above.
+	 * This can steal more than we need, but never less.
+	 */
 	iclog_space = log->l_iclog_size - log->l_iclog_hsize;
-	if (len > 0 && (ctx->space_used / iclog_space !=
-				(ctx->space_used + len) / iclog_space)) {
+	if (len > 0 &&
+	    ((cilpcp->space_used == 0 && !ctx_res) ||
+	     cilpcp->space_used / iclog_space !=
+			(cilpcp->space_used + len) / iclog_space)) {
 		split_res = (len + iclog_space - 1) / iclog_space;
 		/* need to take into account split region headers, too */
 		split_res *= log->l_iclog_hsize + sizeof(struct xlog_op_header);
-		ctx->ticket->t_unit_res += split_res;
-		ctx->ticket->t_curr_res += split_res;
-		tp->t_ticket->t_curr_res -= split_res;
-		ASSERT(tp->t_ticket->t_curr_res >= len);
 	}
-	tp->t_ticket->t_curr_res -= len;
-	ctx->space_used += len;
+	cilpcp->space_reserved += ctx_res + split_res;
 
 	/*
-	 * If we've overrun the reservation, dump the tx details before we move
-	 * the log items. Shutdown is imminent...
+	 * Fold the per-cpu space usage into the context once it gets large
+	 * enough to matter for the background push threshold. Each CPU may
+	 * only hold back its share of the space left below the limit, so
+	 * the global count plus everything still sitting in the per-cpu
+	 * counters stays within the limit, give or take one commit per CPU.
+	 * Once the limit is reached, every commit folds immediately.
 	 */
-	if (WARN_ON(tp->t_ticket->t_curr_res < 0)) {
-		xfs_warn(log->l_mp, "Transaction log reservation overrun:");
-		xfs_warn(log->l_mp,
-			 "  log items: %d bytes (iov hdrs: %d bytes)",
-			 len, iovhdr_res);
-		xfs_warn(log->l_mp, "  split region headers: %d bytes",
-			 split_res);
-		xfs_warn(log->l_mp, "  ctx ticket: %d bytes", ctx_res);
-		xlog_print_trans(tp);
+	space_used = atomic_read(&ctx->space_used);
+	cilpcp->space_used += len;
+	if (space_used >= XLOG_CIL_SPACE_LIMIT(log) ||
+	    cilpcp->space_used >
+			(XLOG_CIL_SPACE_LIMIT(log) - space_used) /
+					num_online_cpus()) {
+		atomic_add(cilpcp->space_used, &ctx->space_used);
+		cilpcp->space_used = 0;
 	}
 
 	/*
-	 * Now (re-)position everything modified at the tail of the CIL.
-	 * We do this here so we only need to take the CIL lock once during
-	 * the transaction commit.
+	 * Now (re-)position everything modified in the CIL. Items that are
+	 * already in the CIL stay on whatever per-cpu list they were first
+	 * added to; the push sorts them back into commit order using the
+	 * order id we stamp on them here.
 	 */
+	order = atomic_inc_return(&ctx->order_id);
 	list_for_each_entry(lip, &tp->t_items, li_trans) {
 
 		/* Skip items which aren't dirty in this transaction. */
 		if (!test_bit(XFS_LI_DIRTY, &lip->li_flags))
 			continue;
 
-		/*
-		 * Only move the item if it isn't already at the tail. This is
-		 * to prevent a transient list_empty() state when reinserting
-		 * an item that is already the only item in the CIL.
-		 */
-		if (!list_is_last(&lip->li_cil, &cil->xc_cil))
-			list_move_tail(&lip->li_cil, &cil->xc_cil);
+		lip->li_order_id = order;
+		if (!list_empty(&lip->li_cil))
+			continue;
+		list_add_tail(&lip->li_cil, &cilpcp->log_items);
 	}
+	put_cpu_ptr(cil->xc_pcp);
 
-	spin_unlock(&cil->xc_cil_lock);
+	tp->t_ticket->t_curr_res -= ctx_res + split_res;
+	ASSERT(!split_res || tp->t_ticket->t_curr_res >= len);
+	tp->t_ticket->t_curr_res -= len;
 
-	if (tp->t_ticket->t_curr_res < 0)
+	/*
+	 * If we've overrun the reservation, dump the tx details. Shutdown is
+	 * imminent...
+	 */
+	if (WARN_ON(tp->t_ticket->t_curr_res < 0)) {
+		xfs_warn(log->l_mp, "Transaction log reservation overrun:");
+		xfs_warn(log->l_mp,
+			 "  log items: %d bytes (iov hdrs: %d bytes)",
+			 len, iovhdr_res);
+		xfs_warn(log->l_mp, "  split region headers: %d bytes",
+			 split_res);
+		xfs_warn(log->l_mp, "  ctx ticket: %d bytes", ctx_res);
+		xlog_print_trans(tp);
 		xfs_force_shutdown(log->l_mp, SHUTDOWN_LOG_IO_ERROR);
+	}
 }
 
 static void
@@ -614,6 +646,68 @@ xlog_cil_committed(
 		kmem_free(ctx);
 }
 
+/* list_sort compare function for CIL items */
+static int
+xlog_cil_order_cmp(
+	void			*priv,
+	struct list_head	*a,
+	struct list_head	*b)
+{
+	struct xfs_log_item	*la;
+	struct xfs_log_item	*lb;
+
+	la = container_of(a, struct xfs_log_item, li_cil);
+	lb = container_of(b, struct xfs_log_item, li_cil);
+	if (la->li_order_id < lb->li_order_id)
+		return -1;
+	else if (la->li_order_id > lb->li_order_id)
+		return 1;
+	return 0;
+}
+
+/*
+ * Pull everything committed into @ctx out of the per-cpu structures. The
+ * items are returned on @items in the order they were last committed, which
+ * is the order the single CIL list used to keep them in: intents have to be
+ * written before the items that complete them.
+ *
+ * Called with the xc_ctx_lock held exclusively, so no commits can be
+ * modifying the per-cpu state concurrently. We walk all possible CPUs so
+ * that anything committed on a CPU that has since gone offline is found.
+ */
+static void
+xlog_cil_pcp_aggregate(
+	struct xfs_cil		*cil,
+	struct xfs_cil_ctx	*ctx,
+	struct list_head	*items)
+{
+	int			space_reserved = 0;
+	int			cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct xlog_cil_pcp	*cilpcp = per_cpu_ptr(cil->xc_pcp, cpu);
+
+		atomic_add(cilpcp->space_used, &ctx->space_used);
+		space_reserved += cilpcp->space_reserved;
+		ctx->nvecs += cilpcp->nvecs;
+		cilpcp->space_used = 0;
+		cilpcp->space_reserved = 0;
+		cilpcp->nvecs = 0;
+
+		list_splice_init(&cilpcp->busy_extents, &ctx->busy_extents);
+		list_splice_init(&cilpcp->log_items, items);
+	}
+	list_sort(NULL, items, xlog_cil_order_cmp);
+
+	/*
+	 * The first commit took the unit reservation of the ticket, everything
+	 * else is additional space for log record headers that the unit
+	 * reservation has to grow by.
+	 */
+	ctx->ticket->t_curr_res += space_reserved;
+	ctx->ticket->t_unit_res = ctx->ticket->t_curr_res;
+}
+
 /*
  * Push the Committed Item List to the log. If @push_seq flag is zero, then it
  * is a background flush and so we can chose to ignore it. Otherwise, if the
@@ -645,6 +739,7 @@ xlog_cil_push(
 	struct xfs_log_vec	lvhdr = { NULL };
 	xfs_lsn_t		commit_lsn;
 	xfs_lsn_t		push_seq;
+	LIST_HEAD(cil_items);
 
 	if (!cil)
 		return 0;
@@ -664,7 +759,7 @@ xlog_cil_push(
 	 * move on to a new sequence number and so we have to be able to push
 	 * this sequence again later.
 	 */
-	if (list_empty(&cil->xc_cil)) {
+	if (test_bit(XLOG_CIL_EMPTY, &cil->xc_flags)) {
 		cil->xc_push_seq = 0;
 		spin_unlock(&cil->xc_push_lock);
 		goto out_skip;
@@ -706,16 +801,17 @@ xlog_cil_push(
 
 	/*
 	 * pull all the log vectors off the items in the CIL, and
-	 * remove the items from the CIL. We don't need the CIL lock
-	 * here because it's only needed on the transaction commit
-	 * side which is currently locked out by the flush lock.
+	 * remove the items from the CIL. We don't need any locking
+	 * for the per-cpu CIL state here because the transaction
+	 * commit side is currently locked out by the flush lock.
 	 */
+	xlog_cil_pcp_aggregate(cil, ctx, &cil_items);
 	lv = NULL;
 	num_iovecs = 0;
-	while (!list_empty(&cil->xc_cil)) {
+	while (!list_empty(&cil_items)) {
 		struct xfs_log_item	*item;
 
-		item = list_first_entry(&cil->xc_cil,
+		item = list_first_entry(&cil_items,
 					struct xfs_log_item, li_cil);
 		list_del_init(&item->li_cil);
 		if (!ctx->lv_chain)
@@ -738,6 +834,7 @@ xlog_cil_push(
 	new_ctx->sequence = ctx->sequence + 1;
 	new_ctx->cil = cil;
 	cil->xc_ctx = new_ctx;
+	set_bit(XLOG_CIL_EMPTY, &cil->xc_flags);
 
 	/*
 	 * The switch is now done, so we can drop the context lock and move out
@@ -894,13 +991,16 @@ xlog_cil_push_background(
 	 * The cil won't be empty because we are called while holding the
 	 * context lock so whatever we added to the CIL will still be there
 	 */
-	ASSERT(!list_empty(&cil->xc_cil));
+	ASSERT(!test_bit(XLOG_CIL_EMPTY, &cil->xc_flags));
 
 	/*
 	 * don't do a background push if we haven't used up all the
-	 * space available yet.
+	 * space available yet. xlog_cil_insert_items() only lets the per-cpu
+	 * counters hold back a share of the space left below the limit, so
+	 * the CIL can overshoot the limit by at most about one commit per CPU
+	 * before we get here.
 	 */
-	if (cil->xc_ctx->space_used < XLOG_CIL_SPACE_LIMIT(log))
+	if (atomic_read(&cil->xc_ctx->space_used) < XLOG_CIL_SPACE_LIMIT(log))
 		return;
 
 	spin_lock(&cil->xc_push_lock);
@@ -938,7 +1038,8 @@ xlog_cil_push_now(
 	 * there's no work we need to do.
 	 */
 	spin_lock(&cil->xc_push_lock);
-	if (list_empty(&cil->xc_cil) || push_seq <= cil->xc_push_seq) {
+	if (test_bit(XLOG_CIL_EMPTY, &cil->xc_flags) ||
+	    push_seq <= cil->xc_push_seq) {
 		spin_unlock(&cil->xc_push_lock);
 		return;
 	}
@@ -956,7 +1057,7 @@ xlog_cil_empty(
 	bool		empty = false;
 
 	spin_lock(&cil->xc_push_lock);
-	if (list_empty(&cil->xc_cil))
+	if (test_bit(XLOG_CIL_EMPTY, &cil->xc_flags))
 		empty = true;
 	spin_unlock(&cil->xc_push_lock);
 	return empty;
@@ -1100,7 +1201,7 @@ xlog_cil_force_lsn(
 	 * we would have found the context on the committing list.
 	 */
 	if (sequence == cil->xc_current_sequence &&
-	    !list_empty(&cil->xc_cil)) {
+	    !test_bit(XLOG_CIL_EMPTY, &cil->xc_flags)) {
 		spin_unlock(&cil->xc_push_lock);
 		goto restart;
 	}
@@ -1159,6 +1260,7 @@ xlog_cil_init(
 {
 	struct xfs_cil	*cil;
 	struct xfs_cil_ctx *ctx;
+	int		cpu;
 
 	cil = kmem_zalloc(sizeof(*cil), KM_SLEEP|KM_MAYFAIL);
 	if (!cil)
@@ -1170,10 +1272,23 @@ xlog_cil_init(
 		return -ENOMEM;
 	}
 
+	cil->xc_pcp = alloc_percpu(struct xlog_cil_pcp);
+	if (!cil->xc_pcp) {
+		kmem_free(ctx);
+		kmem_free(cil);
+		return -ENOMEM;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct xlog_cil_pcp	*cilpcp = per_cpu_ptr(cil->xc_pcp, cpu);
+
+		INIT_LIST_HEAD(&cilpcp->busy_extents);
+		INIT_LIST_HEAD(&cilpcp->log_items);
+	}
+
 	INIT_WORK(&cil->xc_push_work, xlog_cil_push_work);
-	INIT_LIST_HEAD(&cil->xc_cil);
 	INIT_LIST_HEAD(&cil->xc_committing);
-	spin_lock_init(&cil->xc_cil_lock);
+	set_bit(XLOG_CIL_EMPTY, &cil->xc_flags);
 	spin_lock_init(&cil->xc_push_lock);
 	init_rwsem(&cil->xc_ctx_lock);
 	init_waitqueue_head(&cil->xc_commit_wait);
@@ -1200,7 +1315,8 @@ xlog_cil_destroy(
 		kmem_free(log->l_cilp->xc_ctx);
 	}
 
-	ASSERT(list_empty(&log->l_cilp->xc_cil));
+	ASSERT(test_bit(XLOG_CIL_EMPTY, &log->l_cilp->xc_flags));
+	free_percpu(log->l_cilp->xc_pcp);
 	kmem_free(log->l_cilp);
 }
 
@@ -240,7 +240,8 @@ struct xfs_cil_ctx {
 	xfs_lsn_t		commit_lsn;	/* chkpt commit record lsn */
 	struct xlog_ticket	*ticket;	/* chkpt ticket */
 	int			nvecs;		/* number of regions */
-	int			space_used;	/* aggregate size of regions */
+	atomic_t		space_used;	/* aggregate size of regions */
+	atomic_t		order_id;	/* item commit ordering */
 	struct list_head	busy_extents;	/* busy extents in chkpt */
 	struct xfs_log_vec	*lv_chain;	/* logvecs being pushed */
 	struct xfs_log_callback	log_cb;		/* completion callback hook. */
@@ -248,6 +249,22 @@ struct xfs_cil_ctx {
 	struct work_struct	discard_endio_work;
 };
 
+/*
+ * Per-cpu part of the current CIL checkpoint context.
+ *
+ * Transaction commits only ever touch the structure of the CPU they run on,
+ * with preemption disabled and the xc_ctx_lock held shared. The CIL push
+ * aggregates all of them into the checkpoint context while holding the
+ * xc_ctx_lock exclusively.
+ */
+struct xlog_cil_pcp {
+	int			space_used;	/* not yet in ctx->space_used */
+	int			space_reserved;	/* stolen for the ctx ticket */
+	int			nvecs;		/* number of regions */
+	struct list_head	busy_extents;	/* busy extents in chkpt */
+	struct list_head	log_items;	/* items committed on this cpu */
+};
+
 /*
  * Committed Item List structure
  *
@@ -266,8 +283,8 @@ struct xfs_cil_ctx {
  */
 struct xfs_cil {
 	struct xlog		*xc_log;
-	struct list_head	xc_cil;
-	spinlock_t		xc_cil_lock;
+	unsigned long		xc_flags;
+	struct xlog_cil_pcp __percpu *xc_pcp;
 
 	struct rw_semaphore	xc_ctx_lock ____cacheline_aligned_in_smp;
 	struct xfs_cil_ctx	*xc_ctx;
@@ -280,6 +297,9 @@ struct xfs_cil {
 	struct work_struct	xc_push_work;
 } ____cacheline_aligned_in_smp;
 
+/* xc_flags bit values */
+#define	XLOG_CIL_EMPTY		0	/* nothing committed to the ctx yet */
+
 /*
  * The amount of log space we allow the CIL to aggregate is difficult to size.
  * Whatever we choose, we have to make sure we can get a reservation for the
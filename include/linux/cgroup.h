@@ -725,6 +725,13 @@ static inline struct cgroup *cgroup_parent(struct cgroup *cgrp)
 	return NULL;
 }
 
+static inline struct cgroup *cgroup_get_from_fd(int fd)
+{
+	return ERR_PTR(-EOPNOTSUPP);
+}
+
+static inline void cgroup_put(struct cgroup *cgrp) {}
+
 static inline struct psi_group *cgroup_psi(struct cgroup *cgrp)
 {
 	return NULL;
@@ -382,6 +382,13 @@ struct compat_robust_list_head {
 	compat_uptr_t			list_op_pending;
 };
 
+struct compat_futex_wait_block {
+	compat_uptr_t			uaddr;
+	__u32				__pad;
+	__u32				val;
+	__u32				bitset;
+};
+
 #ifdef CONFIG_COMPAT_OLD_SIGACTION
 struct compat_old_sigaction {
 	compat_uptr_t			sa_handler;
@@ -65,7 +65,7 @@ struct dentry_stat_t {
 	long age_limit;		/* age in seconds */
 	long want_pages;	/* pages requested by system */
 	long nr_negative;	/* # of unused negative dentries */
-	long dummy;		/* Reserved for future use */
+	long nr_negative_trimmed; /* # of negative dentries trimmed by limits */
 };
 extern struct dentry_stat_t dentry_stat;
 
@@ -498,6 +498,8 @@ static inline bool d_is_fallthru(const struct dentry *dentry)
 
 
 extern int sysctl_vfs_cache_pressure;
+extern unsigned long sysctl_negative_dentry_limit;
+extern unsigned int sysctl_negative_dentry_dir_limit;
 
 static inline unsigned long vfs_pressure_ratio(unsigned long val)
 {
@@ -208,6 +208,8 @@ struct fsnotify_group {
 			int f_flags; /* event_f_flags from fanotify_init() */
 			unsigned int max_marks;
 			struct user_struct *user;
+			/* pending events indexed for merge lookups */
+			struct hlist_head *merge_hash;
 		} fanotify_data;
 #endif /* CONFIG_FANOTIFY */
 	};
@@ -52,11 +52,17 @@ extern void exit_robust_list(struct task_struct *curr);
 
 long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	      u32 __user *uaddr2, u32 val2, u32 val3);
+
+extern void futex_mm_free(struct mm_struct *mm);
 #else
 static inline void exit_robust_list(struct task_struct *curr)
 {
 }
 
+static inline void futex_mm_free(struct mm_struct *mm)
+{
+}
+
 static inline long do_futex(u32 __user *uaddr, int op, u32 val,
 			    ktime_t *timeout, u32 __user *uaddr2,
 			    u32 val2, u32 val3)
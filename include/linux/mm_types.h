@@ -351,6 +351,7 @@ struct core_state {
 };
 
 struct kioctx_table;
+struct futex_private_hash;
 struct mm_struct {
 	struct {
 		struct vm_area_struct *mmap;		/* list of VMAs */
@@ -448,6 +449,10 @@ struct mm_struct {
 		spinlock_t			ioctx_lock;
 		struct kioctx_table __rcu	*ioctx_table;
 #endif
+#ifdef CONFIG_FUTEX
+		/* hash table for PTHREAD_PROCESS_PRIVATE futexes */
+		struct futex_private_hash	*futex_phash;
+#endif
 #ifdef CONFIG_MEMCG
 		/*
 		 * "owner" points to a task that is regarded as the canonical
@@ -509,7 +514,9 @@ struct mm_struct {
 
 	/*
 	 * The mm_cpumask needs to be at the end of mm_struct, because it
-	 * is dynamically sized based on nr_cpu_ids.
+	 * is dynamically sized based on nr_cpu_ids. With CONFIG_MEMBARRIER,
+	 * mms allocated by fork or exec have the membarrier cpumask right
+	 * after it.
 	 */
 	unsigned long cpu_bitmap[];
 };
@@ -531,6 +538,17 @@ static inline cpumask_t *mm_cpumask(struct mm_struct *mm)
 	return (struct cpumask *)&mm->cpu_bitmap;
 }
 
+#ifdef CONFIG_MEMBARRIER
+/* CPUs currently running a task of @mm, see membarrier_switch_mm(). */
+static inline cpumask_t *mm_membarrier_cpumask(struct mm_struct *mm)
+{
+	unsigned long cpu_bitmap = (unsigned long)mm_cpumask(mm);
+
+	cpu_bitmap += cpumask_size();
+	return (struct cpumask *)cpu_bitmap;
+}
+#endif
+
 struct mmu_gather;
 extern void tlb_gather_mmu(struct mmu_gather *tlb, struct mm_struct *mm,
 				unsigned long start, unsigned long end);
@@ -803,7 +803,7 @@ static inline notrace void rcu_read_unlock_sched_notrace(void)
 /**
  * kfree_rcu() - kfree an object after a grace period.
  * @ptr:	pointer to kfree
- * @rcu_head:	the name of the struct rcu_head within the type of @ptr.
+ * @rhf:	the name of the struct rcu_head within the type of @ptr.
  *
  * Many rcu callbacks functions just call kfree() on the base structure.
  * These functions are trivial, but their size adds up, and furthermore
@@ -825,9 +825,28 @@ static inline notrace void rcu_read_unlock_sched_notrace(void)
  *
  * The BUILD_BUG_ON check must not involve any function calls, hence the
  * checks are done in macros here.
- */
-#define kfree_rcu(ptr, rcu_head)					\
-	__kfree_rcu(&((ptr)->rcu_head), offsetof(typeof(*(ptr)), rcu_head))
+ *
+ * The object can also be freed without an embedded rcu_head, by passing
+ * only @ptr.  This headless form may sleep, it waits for a grace period
+ * in place when no memory is available to defer the kfree(), so it must
+ * only be used from sleepable context.
+ *
+ * Either way, the objects are batched per CPU and released with
+ * kfree_bulk() once a grace period has elapsed.
+ */
+#define kfree_rcu(...) KFREE_GET_MACRO(__VA_ARGS__,			\
+	kfree_rcu_arg_2, kfree_rcu_arg_1)(__VA_ARGS__)
+
+#define KFREE_GET_MACRO(_1, _2, NAME, ...) NAME
+#define kfree_rcu_arg_2(ptr, rhf)					\
+	__kfree_rcu(&((ptr)->rhf), offsetof(typeof(*(ptr)), rhf))
+#define kfree_rcu_arg_1(ptr)						\
+do {									\
+	typeof(ptr) ___p = (ptr);					\
+									\
+	if (___p)							\
+		kfree_call_rcu(NULL, (rcu_callback_t)(unsigned long)(___p)); \
+} while (0)
 
 
 /*
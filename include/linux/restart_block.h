@@ -25,7 +25,7 @@ enum timespec_type {
 struct restart_block {
 	long (*fn)(struct restart_block *);
 	union {
-		/* For futex_wait and futex_wait_requeue_pi */
+		/* For futex_wait, futex_wait_multiple and futex_wait_requeue_pi */
 		struct {
 			u32 __user *uaddr;
 			u32 val;
@@ -372,6 +372,33 @@ static inline void membarrier_execve(struct task_struct *t)
 {
 	atomic_set(&t->mm->membarrier_state, 0);
 }
+
+static inline void membarrier_init_mm(struct mm_struct *mm)
+{
+	cpumask_clear(mm_membarrier_cpumask(mm));
+}
+
+/*
+ * Keep mm_membarrier_cpumask() in sync with the mm this CPU runs, so the
+ * private expedited commands only need to interrupt those CPUs. Called
+ * with preemption disabled wherever the mm of the running task changes:
+ * by the scheduler right after updating rq->curr, and by exec, exit and
+ * use_mm()/unuse_mm(), which change current->mm in place. The barriers
+ * the scheduler provides around rq->curr order the update against
+ * user-space accesses, as they did for the rq->curr based scan.
+ */
+static inline void membarrier_switch_mm(struct mm_struct *prev,
+					struct mm_struct *next)
+{
+	int cpu = smp_processor_id();
+
+	if (prev == next)
+		return;
+	if (prev)
+		cpumask_clear_cpu(cpu, mm_membarrier_cpumask(prev));
+	if (next)
+		cpumask_set_cpu(cpu, mm_membarrier_cpumask(next));
+}
 #else
 #ifdef CONFIG_ARCH_HAS_MEMBARRIER_CALLBACKS
 static inline void membarrier_arch_switch_mm(struct mm_struct *prev,
@@ -386,6 +413,13 @@ static inline void membarrier_execve(struct task_struct *t)
 static inline void membarrier_mm_sync_core_before_usermode(struct mm_struct *mm)
 {
 }
+static inline void membarrier_init_mm(struct mm_struct *mm)
+{
+}
+static inline void membarrier_switch_mm(struct mm_struct *prev,
+					struct mm_struct *next)
+{
+}
 #endif
 
 #endif /* _LINUX_SCHED_MM_H */
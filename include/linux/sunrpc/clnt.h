@@ -128,6 +128,7 @@ struct rpc_create_args {
 	char			*client_name;
 	struct svc_xprt		*bc_xprt;	/* NFSv4.1 backchannel */
 	const struct cred	*cred;
+	unsigned int		nconnect;	/* number of transports */
 };
 
 struct rpc_add_xprt_test {
@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_EVENTFD_H
+#define _UAPI_LINUX_EVENTFD_H
+
+#include <linux/fcntl.h>
+
+/*
+ * CAREFUL: Check include/uapi/asm-generic/fcntl.h when defining
+ * new flags, since they might collide with O_* ones. We want
+ * to re-use O_* flags that couldn't possibly have a meaning
+ * from eventfd, in order to leave a free define-space for
+ * shared O_* flags.
+ */
+#define EFD_SEMAPHORE (1 << 0)
+#define EFD_SHARED_WORD (1 << 1)
+#define EFD_CLOEXEC O_CLOEXEC
+#define EFD_NONBLOCK O_NONBLOCK
+
+/*
+ * An eventfd created with EFD_SHARED_WORD can be mmap()ed: a single page,
+ * MAP_SHARED, at offset 0.  The first 32-bit word of that page holds one
+ * of the values below and lets a producer skip write() while the consumer
+ * is awake.  A blocking read() with the counter at zero only sleeps while
+ * the word reads EFD_WORD_SLEEPING, and fails with EAGAIN otherwise, much
+ * like FUTEX_WAIT.  The protocol is
+ *
+ *	consumer				producer
+ *	--------				--------
+ *	word = EFD_WORD_SLEEPING		queue work
+ *	full barrier				full barrier
+ *	if (no work queued)			if (xchg(word, EFD_WORD_AWAKE)
+ *		read(efd)			    == EFD_WORD_SLEEPING)
+ *	word = EFD_WORD_AWAKE				write(efd, 1)
+ *
+ * Either the consumer sees the queued work, or the producer sees
+ * EFD_WORD_SLEEPING and writes; read() then returns the count, or fails
+ * with EAGAIN if it ran between the xchg() and the write().  The kernel
+ * sets the word to EFD_WORD_AWAKE whenever it adds to the counter.
+ */
+#define EFD_WORD_AWAKE		0
+#define EFD_WORD_SLEEPING	1
+
+#endif /* _UAPI_LINUX_EVENTFD_H */
@@ -21,6 +21,7 @@
 #define FUTEX_WAKE_BITSET	10
 #define FUTEX_WAIT_REQUEUE_PI	11
 #define FUTEX_CMP_REQUEUE_PI	12
+#define FUTEX_WAIT_MULTIPLE	31
 
 #define FUTEX_PRIVATE_FLAG	128
 #define FUTEX_CLOCK_REALTIME	256
@@ -40,6 +41,35 @@
 					 FUTEX_PRIVATE_FLAG)
 #define FUTEX_CMP_REQUEUE_PI_PRIVATE	(FUTEX_CMP_REQUEUE_PI | \
 					 FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAIT_MULTIPLE_PRIVATE	(FUTEX_WAIT_MULTIPLE | \
+					 FUTEX_PRIVATE_FLAG)
+
+/*
+ * Maximum number of futexes a single FUTEX_WAIT_MULTIPLE call may wait on.
+ */
+#define FUTEX_MULTIPLE_MAX_COUNT	128
+
+/**
+ * struct futex_wait_block - One futex of a FUTEX_WAIT_MULTIPLE wait
+ * @uaddr:	user address of the futex
+ * @val:	value the futex is expected to hold
+ * @bitset:	bitset for the optional bitmasked wakeup
+ *
+ * FUTEX_WAIT_MULTIPLE takes an array of these in uaddr and the number
+ * of entries in val.  The call returns the index of the futex that
+ * woke the caller.
+ *
+ * The op number and this 16-byte layout, padded after @uaddr where
+ * pointers are 32 bits wide, match what Wine's fsync already uses.
+ */
+struct futex_wait_block {
+	__u32 __user *uaddr;
+#if __BITS_PER_LONG == 32
+	__u32 __pad;
+#endif
+	__u32 val;
+	__u32 bitset;
+};
 
 /*
  * Support for robust futexes: the kernel cleans up held futexes at
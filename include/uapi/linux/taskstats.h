@@ -205,6 +205,7 @@ enum {
 	TASKSTATS_CMD_ATTR_TGID,
 	TASKSTATS_CMD_ATTR_REGISTER_CPUMASK,
 	TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK,
+	TASKSTATS_CMD_ATTR_CGROUP_FD,	/* restrict a dump to a cgroup */
 	__TASKSTATS_CMD_ATTR_MAX,
 };
 
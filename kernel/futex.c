@@ -215,6 +215,8 @@ struct futex_pi_state {
  * @rt_waiter:		rt_waiter storage for use with requeue_pi
  * @requeue_pi_key:	the requeue_pi target futex key
  * @bitset:		bitset for the optional bitmasked wakeup
+ * @uaddr:		userspace address of the futex (FUTEX_WAIT_MULTIPLE only)
+ * @uval:		expected futex value (FUTEX_WAIT_MULTIPLE only)
  *
  * We use this hashed waitqueue, instead of a normal wait_queue_entry_t, so
  * we can wake only the relevant ones (hashed queues may be shared).
@@ -237,6 +239,8 @@ struct futex_q {
 	struct rt_mutex_waiter *rt_waiter;
 	union futex_key *requeue_pi_key;
 	u32 bitset;
+	u32 __user *uaddr;
+	u32 uval;
 } __randomize_layout;
 
 static const struct futex_q futex_q_init = {
@@ -268,6 +272,24 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * Private futexes of a multithreaded process hash into a table of their
+ * own, allocated on the node of the first task to wait on one of them.
+ * Unrelated processes then no longer contend on the same hash bucket
+ * locks, and the buckets stay node local.  Shared futexes always use the
+ * global table.
+ *
+ * mm->futex_phash is NULL until the table is chosen, and an error pointer
+ * if the allocation failed and the mm stays on the global table.
+ */
+#define FUTEX_PRIVATE_HASH_MIN	16UL
+#define FUTEX_PRIVATE_HASH_MAX	256UL
+
+struct futex_private_hash {
+	unsigned long			hashmask;
+	struct futex_hash_bucket	queues[];
+};
+
 
 /*
  * Fault injections for futexes.
@@ -371,20 +393,86 @@ static inline int hb_waiters_pending(struct futex_hash_bucket *hb)
 }
 
 /**
- * hash_futex - Return the hash bucket in the global hash
+ * hash_futex - Return the hash bucket of a futex key
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket in the global hash, or in the private hash of
+ * the mm for private futexes.
  */
 static struct futex_hash_bucket *hash_futex(union futex_key *key)
 {
+	struct futex_private_hash *fph;
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
+
+	if (!(key->both.offset & (FUT_OFF_INODE|FUT_OFF_MMSHARED))) {
+		fph = READ_ONCE(key->private.mm->futex_phash);
+		if (!IS_ERR_OR_NULL(fph))
+			return &fph->queues[hash & fph->hashmask];
+	}
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
+/**
+ * futex_private_hash_init() - Choose the hash table for @mm's private futexes
+ * @mm:		the mm of the task about to wait on a private futex
+ *
+ * Called before a task queues itself on a private futex.  The choice is
+ * made once, before anybody can be queued on a private futex of @mm, so
+ * waiters and wakers always agree on the table: a waker that still sees
+ * NULL hashes into the global table, where no private waiter of @mm can
+ * be.  The cmpxchg() orders the table before the waiter reads the futex
+ * value, and pairs with barrier (B) in the waker.
+ *
+ * A task that is the only user of @mm has nobody to be woken by on a
+ * private futex, and nobody can start sharing @mm while it sleeps, so it
+ * waits in the global table without committing to anything.
+ *
+ * The table is sized by the number of tasks sharing @mm at that point,
+ * capped at FUTEX_PRIVATE_HASH_MAX buckets, and is not resized later.
+ * If the allocation fails, @mm stays on the global table for good.
+ */
+static void futex_private_hash_init(struct mm_struct *mm)
+{
+	struct futex_private_hash *fph;
+	unsigned long i, size, users;
+
+	if (likely(READ_ONCE(mm->futex_phash)))
+		return;
+	users = atomic_read(&mm->mm_users);
+	if (users == 1)
+		return;
+
+	size = roundup_pow_of_two(4 * users);
+	size = clamp(size, FUTEX_PRIVATE_HASH_MIN,
+		     min(FUTEX_PRIVATE_HASH_MAX, futex_hashsize));
+
+	fph = kvmalloc_node(struct_size(fph, queues, size),
+			    GFP_KERNEL_ACCOUNT | __GFP_NOWARN, numa_node_id());
+	if (fph) {
+		fph->hashmask = size - 1;
+		for (i = 0; i < size; i++) {
+			atomic_set(&fph->queues[i].waiters, 0);
+			plist_head_init(&fph->queues[i].chain);
+			spin_lock_init(&fph->queues[i].lock);
+		}
+	} else {
+		fph = ERR_PTR(-ENOMEM);
+	}
+
+	/* Somebody else may have chosen first */
+	if (cmpxchg(&mm->futex_phash, NULL, fph) && !IS_ERR(fph))
+		kvfree(fph);
+}
+
+void futex_mm_free(struct mm_struct *mm)
+{
+	if (!IS_ERR_OR_NULL(mm->futex_phash))
+		kvfree(mm->futex_phash);
+}
+
 
 /**
  * match_futex - Check whether two futex keys are equal
@@ -2689,6 +2777,9 @@ static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
 		return -EINVAL;
 	q.bitset = bitset;
 
+	if (!(flags & FLAGS_SHARED))
+		futex_private_hash_init(current->mm);
+
 	if (abs_time) {
 		to = &timeout;
 
@@ -2767,6 +2858,315 @@ static long futex_wait_restart(struct restart_block *restart)
 }
 
 
+/**
+ * unqueue_multiple() - Remove several futexes from their hash buckets
+ * @qs:		array of futexes to unqueue
+ * @count:	number of futexes in @qs
+ *
+ * Helper to unqueue a list of futexes.  This can't fail.  Drops the key
+ * references taken when the futexes were queued.
+ *
+ * Return:
+ *  - >=0 - index of the first futex in @qs that had already been woken
+ *  - -1  - no futex in @qs had been woken
+ */
+static int unqueue_multiple(struct futex_q *qs, int count)
+{
+	int ret = -1;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (!unqueue_me(&qs[i]) && ret < 0)
+			ret = i;
+	}
+	return ret;
+}
+
+/**
+ * futex_wait_multiple_setup() - Prepare to wait on and queue several futexes
+ * @qs:		array of futexes to wait on, with uaddr, uval and bitset set
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @count:	number of futexes in @qs
+ * @woken:	index of a futex that was woken during setup, if any
+ *
+ * Queue all the futexes of @qs, checking each against its expected value
+ * under its hash bucket lock, exactly like futex_wait_setup() does for a
+ * single futex.
+ *
+ * The hash bucket locks cannot be held across the whole list, so every
+ * futex is queued as soon as its value has been checked.  The task state
+ * is set to TASK_INTERRUPTIBLE before the first futex is queued, so a
+ * wakeup arriving while the rest of the list is being set up is not lost.
+ * That in turn means nothing that may sleep can run while queueing, which
+ * is why all the keys are looked up beforehand.
+ *
+ * Return:
+ *  -  1 - a futex was woken during setup, its index is in @woken;
+ *  -  0 - success, all futexes are queued and the task is TASK_INTERRUPTIBLE;
+ *  - <0 - -EFAULT or -EWOULDBLOCK, nothing is queued.
+ */
+static int futex_wait_multiple_setup(struct futex_q *qs, unsigned int flags,
+				     int count, int *woken)
+{
+	struct futex_hash_bucket *hb;
+	int ret, i, j;
+	u32 uval;
+
+retry:
+	for (i = 0; i < count; i++) {
+		ret = get_futex_key(qs[i].uaddr, flags & FLAGS_SHARED,
+				    &qs[i].key, FUTEX_READ);
+		if (unlikely(ret)) {
+			while (--i >= 0)
+				put_futex_key(&qs[i].key);
+			return ret;
+		}
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+
+	for (i = 0; i < count; i++) {
+		struct futex_q *q = &qs[i];
+
+		hb = queue_lock(q);
+
+		ret = get_futex_value_locked(&uval, q->uaddr);
+		if (!ret && uval == q->uval) {
+			/*
+			 * Queue now so that the hash bucket lock can be
+			 * dropped before dealing with the next futex.
+			 */
+			queue_me(q, hb);
+			continue;
+		}
+
+		queue_unlock(hb);
+
+		/*
+		 * Undo everything: unqueue_multiple() drops the references
+		 * of the futexes already queued, the remaining keys have
+		 * to be put by hand.
+		 */
+		*woken = unqueue_multiple(qs, i);
+		for (j = i; j < count; j++)
+			put_futex_key(&qs[j].key);
+		__set_current_state(TASK_RUNNING);
+
+		if (ret) {
+			/*
+			 * A real fault takes precedence over a concurrent
+			 * wakeup: userspace handed us a bad address.
+			 */
+			ret = get_user(uval, q->uaddr);
+			if (ret)
+				return ret;
+		} else {
+			ret = -EWOULDBLOCK;
+		}
+
+		/*
+		 * Something was woken while we were setting up, report it
+		 * rather than the error so that userspace can go and grab
+		 * the right object right away.
+		 */
+		if (*woken >= 0)
+			return 1;
+
+		if (ret)
+			return ret;
+
+		/* The fault was handled, start over. */
+		goto retry;
+	}
+
+	return 0;
+}
+
+/**
+ * futex_sleep_multiple() - Wait for one of several futexes to be woken
+ * @qs:		array of futexes to wait on
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @count:	number of futexes in @qs
+ * @to:		the prepared hrtimer_sleeper, or null for no timeout
+ *
+ * Return:
+ *  - >=0 - index of the futex that woke us;
+ *  - <0  - -ETIMEDOUT, -ERESTARTSYS or an error from the setup.
+ */
+static int futex_sleep_multiple(struct futex_q *qs, unsigned int flags,
+				int count, struct hrtimer_sleeper *to)
+{
+	int ret, woken = -1;
+	int i;
+
+	for (;;) {
+		ret = futex_wait_multiple_setup(qs, flags, count, &woken);
+		if (ret)
+			return ret > 0 ? woken : ret;
+
+		/* Arm the timer */
+		if (to)
+			hrtimer_start_expires(&to->timer, HRTIMER_MODE_ABS);
+
+		/*
+		 * If any futex has been removed from its hash list, another
+		 * task has tried to wake us, and we can skip the call to
+		 * schedule().  Likewise if the timer has already expired.
+		 */
+		for (i = 0; i < count; i++) {
+			if (plist_node_empty(&qs[i].list))
+				break;
+		}
+
+		if (i == count && (!to || to->task))
+			freezable_schedule();
+
+		__set_current_state(TASK_RUNNING);
+
+		/* unqueue_multiple() drops the key refs */
+		ret = unqueue_multiple(qs, count);
+		if (ret >= 0)
+			return ret;
+
+		if (to && !to->task)
+			return -ETIMEDOUT;
+
+		if (signal_pending(current))
+			return -ERESTARTSYS;
+
+		/* A spurious wakeup, go back to sleep. */
+	}
+}
+
+/*
+ * Fetch entry @idx of the futex_wait_block array handed to
+ * FUTEX_WAIT_MULTIPLE.  Compat tasks hand us compat_futex_wait_blocks.
+ */
+static int futex_get_wait_block(struct futex_wait_block *block,
+				void __user *uaddr, int idx)
+{
+	BUILD_BUG_ON(sizeof(struct futex_wait_block) != 16);
+#ifdef CONFIG_COMPAT
+	BUILD_BUG_ON(sizeof(struct compat_futex_wait_block) != 16);
+	if (in_compat_syscall()) {
+		struct compat_futex_wait_block __user *cwb = uaddr;
+		struct compat_futex_wait_block cblock;
+
+		if (copy_from_user(&cblock, &cwb[idx], sizeof(cblock)))
+			return -EFAULT;
+		block->uaddr = compat_ptr(cblock.uaddr);
+		block->val = cblock.val;
+		block->bitset = cblock.bitset;
+		return 0;
+	}
+#endif
+	if (copy_from_user(block, (struct futex_wait_block __user *)uaddr + idx,
+			   sizeof(*block)))
+		return -EFAULT;
+	return 0;
+}
+
+static long futex_wait_multiple_restart(struct restart_block *restart);
+
+/**
+ * futex_wait_multiple() - Wait on an array of futexes
+ * @uaddr:	userspace array of struct futex_wait_block
+ * @flags:	futex flags (FLAGS_SHARED, etc.)
+ * @count:	number of entries in @uaddr
+ * @abs_time:	absolute timeout, or null for none
+ *
+ * Sleep until one of the futexes is woken, the timeout expires or a
+ * signal arrives.  Each futex gets its own futex_q, so the wake side is
+ * the regular FUTEX_WAKE path and needs no knowledge of the multiple
+ * wait: the task is simply queued in several hash buckets at once.
+ *
+ * Return: the index in @uaddr of the futex that woke us, or a negative
+ * error code.
+ */
+static int futex_wait_multiple(u32 __user *uaddr, unsigned int flags,
+			       u32 count, ktime_t *abs_time)
+{
+	struct hrtimer_sleeper timeout, *to = NULL;
+	struct restart_block *restart;
+	struct futex_q *qs;
+	int ret, i;
+
+	if (!count || count > FUTEX_MULTIPLE_MAX_COUNT)
+		return -EINVAL;
+
+	if (!(flags & FLAGS_SHARED))
+		futex_private_hash_init(current->mm);
+
+	qs = kcalloc(count, sizeof(*qs), GFP_KERNEL);
+	if (!qs)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		struct futex_wait_block block;
+
+		ret = futex_get_wait_block(&block, (void __user *)uaddr, i);
+		if (ret)
+			goto out_free;
+
+		ret = -EINVAL;
+		if (!block.bitset)
+			goto out_free;
+
+		qs[i] = futex_q_init;
+		qs[i].uaddr = block.uaddr;
+		qs[i].uval = block.val;
+		qs[i].bitset = block.bitset;
+	}
+
+	if (abs_time) {
+		to = &timeout;
+
+		hrtimer_init_on_stack(&to->timer, (flags & FLAGS_CLOCKRT) ?
+				      CLOCK_REALTIME : CLOCK_MONOTONIC,
+				      HRTIMER_MODE_ABS);
+		hrtimer_init_sleeper(to, current);
+		hrtimer_set_expires_range_ns(&to->timer, *abs_time,
+					     current->timer_slack_ns);
+	}
+
+	ret = futex_sleep_multiple(qs, flags, count, to);
+
+	if (ret == -ERESTARTSYS && abs_time) {
+		restart = &current->restart_block;
+		restart->fn = futex_wait_multiple_restart;
+		restart->futex.uaddr = uaddr;
+		restart->futex.val = count;
+		restart->futex.time = *abs_time;
+		restart->futex.flags = flags | FLAGS_HAS_TIMEOUT;
+
+		ret = -ERESTART_RESTARTBLOCK;
+	}
+
+	if (to) {
+		hrtimer_cancel(&to->timer);
+		destroy_hrtimer_on_stack(&to->timer);
+	}
+out_free:
+	kfree(qs);
+	return ret;
+}
+
+static long futex_wait_multiple_restart(struct restart_block *restart)
+{
+	u32 __user *uaddr = restart->futex.uaddr;
+	ktime_t t, *tp = NULL;
+
+	if (restart->futex.flags & FLAGS_HAS_TIMEOUT) {
+		t = restart->futex.time;
+		tp = &t;
+	}
+	restart->fn = do_no_restart_syscall;
+
+	return (long)futex_wait_multiple(uaddr, restart->futex.flags,
+					 restart->futex.val, tp);
+}
+
+
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
  * and failed. The kernel side here does the whole locking operation:
@@ -2789,6 +3189,9 @@ static int futex_lock_pi(u32 __user *uaddr, unsigned int flags,
 	if (!IS_ENABLED(CONFIG_FUTEX_PI))
 		return -ENOSYS;
 
+	if (!(flags & FLAGS_SHARED))
+		futex_private_hash_init(current->mm);
+
 	if (refill_pi_state_cache())
 		return -ENOMEM;
 
@@ -3206,6 +3609,9 @@ static int futex_wait_requeue_pi(u32 __user *uaddr, unsigned int flags,
 	if (!IS_ENABLED(CONFIG_FUTEX_PI))
 		return -ENOSYS;
 
+	if (!(flags & FLAGS_SHARED))
+		futex_private_hash_init(current->mm);
+
 	if (uaddr == uaddr2)
 		return -EINVAL;
 
@@ -3658,6 +4064,8 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 					     uaddr2);
 	case FUTEX_CMP_REQUEUE_PI:
 		return futex_requeue(uaddr, flags, uaddr2, val, val2, &val3, 1);
+	case FUTEX_WAIT_MULTIPLE:
+		return futex_wait_multiple(uaddr, flags, val, timeout);
 	}
 	return -ENOSYS;
 }
@@ -3674,7 +4082,8 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (unlikely(should_fail_futex(!(op & FUTEX_PRIVATE_FLAG))))
 			return -EFAULT;
 		if (get_timespec64(&ts, utime))
@@ -3683,7 +4092,7 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 			return -EINVAL;
 
 		t = timespec64_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -3867,14 +4276,15 @@ SYSCALL_DEFINE6(futex_time32, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_MULTIPLE)) {
 		if (get_old_timespec32(&ts, utime))
 			return -EFAULT;
 		if (!timespec64_valid(&ts))
 			return -EINVAL;
 
 		t = timespec64_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_MULTIPLE)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
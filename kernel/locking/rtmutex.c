@@ -19,6 +19,7 @@
 #include <linux/sched/wake_q.h>
 #include <linux/sched/debug.h>
 #include <linux/timer.h>
+#include <trace/events/lock.h>
 
 #include "rtmutex_common.h"
 
@@ -1255,6 +1256,8 @@ rt_mutex_slowlock(struct rt_mutex *lock, int state,
 		return 0;
 	}
 
+	trace_contention_begin(lock, LCB_F_RT);
+
 	set_current_state(state);
 
 	/* Setup the timer, when timeout != NULL */
@@ -1287,6 +1290,8 @@ rt_mutex_slowlock(struct rt_mutex *lock, int state,
 
 	debug_rt_mutex_free_waiter(&waiter);
 
+	trace_contention_end(lock, ret);
+
 	return ret;
 }
 
@@ -13,9 +13,9 @@
 extern raw_spinlock_t logbuf_lock;
 
 __printf(5, 0)
-int vprintk_store(int facility, int level,
-		  const char *dict, size_t dictlen,
-		  const char *fmt, va_list args);
+int printk_ring_store(int facility, int level,
+		      const char *dict, size_t dictlen,
+		      const char *fmt, va_list args);
 
 __printf(1, 0) int vprintk_default(const char *fmt, va_list args);
 __printf(1, 0) int vprintk_deferred(const char *fmt, va_list args);
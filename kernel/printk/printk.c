@@ -43,6 +43,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -1828,7 +1829,7 @@ static void cont_flush(void)
 	cont.len = 0;
 }
 
-static bool cont_add(u32 caller_id, int facility, int level,
+static bool cont_add(u32 caller_id, u64 ts_nsec, int facility, int level,
 		     enum log_flags flags, const char *text, size_t len)
 {
 	/* If the line gets too long, split it up in separate records. */
@@ -1841,7 +1842,7 @@ static bool cont_add(u32 caller_id, int facility, int level,
 		cont.facility = facility;
 		cont.level = level;
 		cont.caller_id = caller_id;
-		cont.ts_nsec = local_clock();
+		cont.ts_nsec = ts_nsec ? ts_nsec : local_clock();
 		cont.flags = flags;
 	}
 
@@ -1858,17 +1859,18 @@ static bool cont_add(u32 caller_id, int facility, int level,
 	return true;
 }
 
-static size_t log_output(int facility, int level, enum log_flags lflags, const char *dict, size_t dictlen, char *text, size_t text_len)
+static size_t log_output(u32 caller_id, u64 ts_nsec, int facility, int level,
+			 enum log_flags lflags, const char *dict, size_t dictlen,
+			 char *text, size_t text_len)
 {
-	const u32 caller_id = printk_caller_id();
-
 	/*
 	 * If an earlier line was buffered, and we're a continuation
 	 * write from the same context, try to add it to the buffer.
 	 */
 	if (cont.len) {
 		if (cont.caller_id == caller_id && (lflags & LOG_CONT)) {
-			if (cont_add(caller_id, facility, level, lflags, text, text_len))
+			if (cont_add(caller_id, ts_nsec, facility, level,
+				     lflags, text, text_len))
 				return text_len;
 		}
 		/* Otherwise, make sure it's flushed */
@@ -1881,31 +1883,24 @@ static size_t log_output(int facility, int level, enum log_flags lflags, const c
 
 	/* If it doesn't end in a newline, try to buffer the current line */
 	if (!(lflags & LOG_NEWLINE)) {
-		if (cont_add(caller_id, facility, level, lflags, text, text_len))
+		if (cont_add(caller_id, ts_nsec, facility, level, lflags,
+			     text, text_len))
 			return text_len;
 	}
 
 	/* Store it in the record log */
-	return log_store(caller_id, facility, level, lflags, 0,
+	return log_store(caller_id, facility, level, lflags, ts_nsec,
 			 dict, dictlen, text, text_len);
 }
 
 /* Must be called under logbuf_lock. */
-int vprintk_store(int facility, int level,
-		  const char *dict, size_t dictlen,
-		  const char *fmt, va_list args)
+static size_t log_parse_output(u32 caller_id, u64 ts_nsec,
+			       int facility, int level,
+			       const char *dict, size_t dictlen,
+			       char *text, size_t text_len)
 {
-	static char textbuf[LOG_LINE_MAX];
-	char *text = textbuf;
-	size_t text_len;
 	enum log_flags lflags = 0;
 
-	/*
-	 * The printf needs to come first; we need the syslog
-	 * prefix which might be passed-in as a parameter.
-	 */
-	text_len = vscnprintf(text, sizeof(textbuf), fmt, args);
-
 	/* mark and strip a trailing newline */
 	if (text_len && text[text_len-1] == '\n') {
 		text_len--;
@@ -1937,18 +1932,281 @@ int vprintk_store(int facility, int level,
 	if (dict)
 		lflags |= LOG_NEWLINE;
 
-	return log_output(facility, level, lflags,
+	return log_output(caller_id, ts_nsec, facility, level, lflags,
 			  dict, dictlen, text, text_len);
 }
 
+/*
+ * Lockless multi-writer ring in front of the record buffer.
+ *
+ * printk() stores its message here without taking logbuf_lock, so that
+ * CPUs printing at the same time, or from NMI, do not serialize on it.
+ * A writer reserves space by advancing @prb_head with cmpxchg, fills in
+ * the record and publishes it by setting its token to the reserved
+ * position plus one. The consumer, serialized by logbuf_lock, moves the
+ * committed records in order into the record buffer, clears their space
+ * and hands it back by advancing @prb_tail.
+ *
+ * A record never wraps. When it does not fit before the end of the ring,
+ * the rest of the ring is skipped with a padding record, or implicitly
+ * when not even a header fits. When the ring is full, a message is
+ * stored directly under logbuf_lock instead. Only in NMI, where that lock
+ * cannot be taken, is it dropped, which is reported once the consumer
+ * catches up.
+ */
+#define PRB_BUF_SHIFT	(CONFIG_LOG_BUF_SHIFT > 16 ? CONFIG_LOG_BUF_SHIFT - 2 : 14)
+#define PRB_BUF_LEN	(1UL << PRB_BUF_SHIFT)
+#define PRB_ALIGN	8
+#define PRB_HDR_LEN	ALIGN(sizeof(struct prb_record), PRB_ALIGN)
+
+struct prb_record {
+	unsigned long token;		/* reserved position + 1 once committed */
+	u32 size;			/* record size, header and padding included */
+	u32 caller_id;			/* printk_caller_id() of the writer */
+	u64 ts_nsec;			/* timestamp in nanoseconds */
+	u16 text_len;			/* length of text, prefix included */
+	u16 dict_len;			/* length of dictionary following the text */
+	u8 facility;			/* syslog facility */
+	s8 level;			/* log level as passed to vprintk_emit() */
+	bool pad;			/* skips the end of the ring, no message */
+};
+
+static char prb_buf[PRB_BUF_LEN] __aligned(PRB_ALIGN);
+static atomic_long_t prb_head = ATOMIC_LONG_INIT(0);
+static unsigned long prb_tail;
+static atomic_long_t prb_dropped = ATOMIC_LONG_INIT(0);
+
+/* Printer kthread, set once it is able to take over the consoles. */
+static struct task_struct *printk_kthread;
+
+static struct prb_record *prb_reserve(u32 size, unsigned long *pos)
+{
+	unsigned long head, tail, off, need;
+	struct prb_record *rec;
+
+	do {
+		head = atomic_long_read(&prb_head);
+		/* Pairs with the release in printk_ring_drain_locked(). */
+		tail = smp_load_acquire(&prb_tail);
+		off = head & (PRB_BUF_LEN - 1);
+		need = size;
+		if (PRB_BUF_LEN - off < size)
+			need += PRB_BUF_LEN - off;
+		if (head + need - tail > PRB_BUF_LEN)
+			return NULL;
+	} while ((unsigned long)atomic_long_cmpxchg(&prb_head, head,
+						    head + need) != head);
+
+	if (need != size) {
+		if (need - size >= PRB_HDR_LEN) {
+			rec = (struct prb_record *)(prb_buf + off);
+			rec->size = need - size;
+			rec->pad = true;
+			smp_store_release(&rec->token, head + 1);
+		}
+		head += need - size;
+		off = 0;
+	}
+
+	rec = (struct prb_record *)(prb_buf + off);
+	/* Lets the panic CPU step over a record whose writer was stopped. */
+	WRITE_ONCE(rec->size, size);
+	*pos = head;
+	return rec;
+}
+
+/*
+ * Store a message in the lockless ring. Can be called from any context.
+ * Returns the length of the formatted text, or -ENOSPC when the ring is
+ * full, in which case @args has not been consumed.
+ */
+int printk_ring_store(int facility, int level,
+		      const char *dict, size_t dictlen,
+		      const char *fmt, va_list args)
+{
+	struct prb_record *rec;
+	unsigned long flags, pos;
+	size_t text_len;
+	va_list args2;
+	char *text;
+
+	va_copy(args2, args);
+	text_len = vsnprintf(NULL, 0, fmt, args2);
+	va_end(args2);
+
+	text_len = min_t(size_t, text_len, LOG_LINE_MAX - 1);
+	dictlen = min_t(size_t, dictlen, LOG_LINE_MAX);
+
+	local_irq_save(flags);
+	rec = prb_reserve(ALIGN(PRB_HDR_LEN + text_len + 1 + dictlen,
+				PRB_ALIGN), &pos);
+	if (!rec) {
+		local_irq_restore(flags);
+		return -ENOSPC;
+	}
+
+	text = (char *)rec + PRB_HDR_LEN;
+	text_len = vscnprintf(text, text_len + 1, fmt, args);
+	if (dictlen)
+		memcpy(text + text_len, dict, dictlen);
+
+	rec->caller_id = printk_caller_id();
+	rec->ts_nsec = local_clock();
+	rec->text_len = text_len;
+	rec->dict_len = dictlen;
+	rec->facility = facility;
+	rec->level = level;
+	rec->pad = false;
+	smp_store_release(&rec->token, pos + 1);
+	local_irq_restore(flags);
+
+	return text_len;
+}
+
+static struct prb_record *prb_first(unsigned long *tail)
+{
+	unsigned long off = *tail & (PRB_BUF_LEN - 1);
+
+	if (PRB_BUF_LEN - off < PRB_HDR_LEN) {
+		*tail += PRB_BUF_LEN - off;
+		off = 0;
+	}
+	return (struct prb_record *)(prb_buf + off);
+}
+
+/* Is a committed message waiting in the ring? */
+static bool printk_ring_pending(void)
+{
+	unsigned long tail = READ_ONCE(prb_tail);
+	struct prb_record *rec;
+
+	if (tail == atomic_long_read(&prb_head))
+		return false;
+
+	rec = prb_first(&tail);
+	return READ_ONCE(rec->token) == tail + 1;
+}
+
+/*
+ * Move the committed messages from the ring to the record buffer and let
+ * the /dev/kmsg and syslog() readers know about them. Must be called
+ * under logbuf_lock.
+ */
+static void printk_ring_drain_locked(void)
+{
+	unsigned long tail = prb_tail;
+	bool stored = false;
+	long dropped;
+
+	while (tail != atomic_long_read(&prb_head)) {
+		struct prb_record *rec = prb_first(&tail);
+		u32 size;
+
+		if (smp_load_acquire(&rec->token) != tail + 1) {
+			/*
+			 * The writer may still be filling in the record.
+			 * On panic, it was stopped with the other CPUs and
+			 * will never commit, so step over the record if
+			 * it got as far as sizing it.
+			 */
+			size = READ_ONCE(rec->size);
+			if (atomic_read(&panic_cpu) != raw_smp_processor_id() ||
+			    !size)
+				break;
+		} else {
+			size = rec->size;
+			if (!rec->pad) {
+				char *text = (char *)rec + PRB_HDR_LEN;
+
+				log_parse_output(rec->caller_id, rec->ts_nsec,
+						 rec->facility, rec->level,
+						 rec->dict_len ?
+						 text + rec->text_len : NULL,
+						 rec->dict_len,
+						 text, rec->text_len);
+				stored = true;
+			}
+		}
+
+		memset(rec, 0, size);
+		tail += size;
+		/* Hands the cleared space back to prb_reserve(). */
+		smp_store_release(&prb_tail, tail);
+	}
+
+	if (unlikely(atomic_long_read(&prb_dropped))) {
+		char text[64];
+		size_t len;
+
+		dropped = atomic_long_xchg(&prb_dropped, 0);
+		len = scnprintf(text, sizeof(text),
+				"** %ld printk messages dropped by a full ring **",
+				dropped);
+		log_output(printk_caller_id(), 0, 0, LOGLEVEL_WARNING,
+			   LOG_NEWLINE, NULL, 0, text, len);
+		stored = true;
+	}
+
+	/* Only queues irq_work, so it is fine under logbuf_lock. */
+	if (stored)
+		wake_up_klogd();
+}
+
+static void printk_ring_drain(void)
+{
+	unsigned long flags;
+
+	if (!printk_ring_pending() && !atomic_long_read(&prb_dropped))
+		return;
+
+	logbuf_lock_irqsave(flags);
+	printk_ring_drain_locked();
+	logbuf_unlock_irqrestore(flags);
+}
+
+/*
+ * Store a message straight into the record buffer, behind what is still
+ * queued in the ring. Used when the ring is full, so that a consumer that
+ * is behind, e.g. stuck on a slow console, does not make messages vanish
+ * from dmesg and kmsg_dump as well. Must not be called from NMI.
+ */
+static int printk_store_locked(int facility, int level,
+			       const char *dict, size_t dictlen,
+			       const char *fmt, va_list args)
+{
+	static char textbuf[LOG_LINE_MAX];
+	unsigned long flags;
+	size_t text_len;
+
+	logbuf_lock_irqsave(flags);
+	printk_ring_drain_locked();
+	text_len = vscnprintf(textbuf, sizeof(textbuf), fmt, args);
+	log_parse_output(printk_caller_id(), local_clock(), facility, level,
+			 dict, dictlen, textbuf, text_len);
+	logbuf_unlock_irqrestore(flags);
+
+	wake_up_klogd();
+	return text_len;
+}
+
+/*
+ * The printing CPU flushes the consoles itself until the printer kthread
+ * is up, and again once the system is going down or panicking, when the
+ * kthread may never get to run.
+ */
+static bool printk_direct(void)
+{
+	return !READ_ONCE(printk_kthread) || oops_in_progress ||
+	       system_state > SYSTEM_RUNNING ||
+	       atomic_read(&panic_cpu) != PANIC_CPU_INVALID;
+}
+
 asmlinkage int vprintk_emit(int facility, int level,
 			    const char *dict, size_t dictlen,
 			    const char *fmt, va_list args)
 {
 	int printed_len;
-	bool in_sched = false, pending_output;
-	unsigned long flags;
-	u64 curr_log_seq;
+	bool in_sched = false;
 
 	/* Suppress unimportant messages after panic happens */
 	if (unlikely(suppress_printk))
@@ -1962,33 +2220,45 @@ asmlinkage int vprintk_emit(int facility, int level,
 	boot_delay_msec(level);
 	printk_delay();
 
-	/* This stops the holder of console_sem just where we want him */
-	logbuf_lock_irqsave(flags);
-	curr_log_seq = log_next_seq;
-	printed_len = vprintk_store(facility, level, dict, dictlen, fmt, args);
-	pending_output = (curr_log_seq != log_next_seq);
-	logbuf_unlock_irqrestore(flags);
+	printed_len = printk_ring_store(facility, level, dict, dictlen,
+					fmt, args);
+	if (printed_len < 0) {
+		if (in_nmi()) {
+			atomic_long_inc(&prb_dropped);
+			return 0;
+		}
+		printed_len = printk_store_locked(facility, level, dict,
+						  dictlen, fmt, args);
+	}
 
-	/* If called from the scheduler, we can not call up(). */
-	if (!in_sched && pending_output) {
-		/*
-		 * Disable preemption to avoid being preempted while holding
-		 * console_sem which would prevent anyone from printing to
-		 * console
-		 */
-		preempt_disable();
-		/*
-		 * Try to acquire and then immediately release the console
-		 * semaphore.  The release will print out buffers and wake up
-		 * /dev/kmsg and syslog() users.
-		 */
-		if (console_trylock_spinning())
-			console_unlock();
-		preempt_enable();
+	/*
+	 * Neither the scheduler nor NMI context can wake up a task or take
+	 * logbuf_lock, and printk() may be called with an rq lock or
+	 * ->pi_lock held without saying so. Leave both kicking the printer
+	 * kthread and the scheduler/NMI case to irq_work.
+	 */
+	if (in_sched || in_nmi() || !printk_direct()) {
+		defer_console_output();
+		return printed_len;
 	}
 
-	if (pending_output)
-		wake_up_klogd();
+	printk_ring_drain();
+
+	/*
+	 * Disable preemption to avoid being preempted while holding
+	 * console_sem which would prevent anyone from printing to
+	 * console
+	 */
+	preempt_disable();
+	/*
+	 * Try to acquire and then immediately release the console
+	 * semaphore.  The release will print out buffers and wake up
+	 * /dev/kmsg and syslog() users.
+	 */
+	if (console_trylock_spinning())
+		console_unlock();
+	preempt_enable();
+
 	return printed_len;
 }
 EXPORT_SYMBOL(vprintk_emit);
@@ -2081,6 +2351,8 @@ static void call_console_drivers(const char *ext_text, size_t ext_len,
 static size_t msg_print_text(const struct printk_log *msg, bool syslog,
 			     bool time, char *buf, size_t size) { return 0; }
 static bool suppress_message_printing(int level) { return false; }
+static bool printk_ring_pending(void) { return false; }
+static void printk_ring_drain_locked(void) { }
 
 #endif /* CONFIG_PRINTK */
 
@@ -2402,6 +2674,7 @@ void console_unlock(void)
 
 		printk_safe_enter_irqsave(flags);
 		raw_spin_lock(&logbuf_lock);
+		printk_ring_drain_locked();
 		if (console_seq < log_first_seq) {
 			len = sprintf(text,
 				      "** %llu printk messages dropped **\n",
@@ -2487,7 +2760,7 @@ void console_unlock(void)
 	 * flush, no worries.
 	 */
 	raw_spin_lock(&logbuf_lock);
-	retry = console_seq != log_next_seq;
+	retry = console_seq != log_next_seq || printk_ring_pending();
 	raw_spin_unlock(&logbuf_lock);
 	printk_safe_exit_irqrestore(flags);
 
@@ -2940,9 +3213,19 @@ static void wake_up_klogd_work_func(struct irq_work *irq_work)
 	int pending = __this_cpu_xchg(printk_pending, 0);
 
 	if (pending & PRINTK_PENDING_OUTPUT) {
-		/* If trylock fails, someone else is doing the printing */
-		if (console_trylock())
-			console_unlock();
+		/*
+		 * Keep the record buffer up to date even when the kthread
+		 * is behind on the consoles, so the ring does not fill up.
+		 */
+		printk_ring_drain();
+		if (!printk_direct()) {
+			/* No scheduler locks are held from irq_work. */
+			wake_up_process(printk_kthread);
+		} else {
+			/* If trylock fails, someone else is doing the printing */
+			if (console_trylock())
+				console_unlock();
+		}
 	}
 
 	if (pending & PRINTK_PENDING_WAKEUP)
@@ -2972,6 +3255,45 @@ void defer_console_output(void)
 	preempt_enable();
 }
 
+/*
+ * The printer kthread moves messages from the lockless ring to the record
+ * buffer and prints them, so that printk() callers never get stuck
+ * flushing slow consoles on behalf of everybody else.
+ */
+static int printk_kthread_func(void *data)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!printk_ring_pending())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		printk_ring_drain();
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_kthread_init(void)
+{
+	struct task_struct *tsk;
+
+	tsk = kthread_run(printk_kthread_func, NULL, "printk");
+	if (IS_ERR(tsk)) {
+		pr_err("unable to start the printer thread, printing synchronously\n");
+		return PTR_ERR(tsk);
+	}
+	WRITE_ONCE(printk_kthread, tsk);
+
+	/* Catch up with what was stored while the thread was starting. */
+	wake_up_process(tsk);
+	return 0;
+}
+late_initcall(printk_kthread_init);
+
 int vprintk_deferred(const char *fmt, va_list args)
 {
 	int r;
@@ -3107,6 +3429,9 @@ void kmsg_dump(enum kmsg_dump_reason reason)
 	if ((reason > KMSG_DUMP_OOPS) && !always_kmsg_dump)
 		return;
 
+	/* Dumpers only look at the record buffer. */
+	printk_ring_drain();
+
 	rcu_read_lock();
 	list_for_each_entry_rcu(dumper, &dump_list, list) {
 		if (dumper->max_reason && reason > dumper->max_reason)
@@ -14,10 +14,12 @@
 #include "internal.h"
 
 /*
- * printk() could not take logbuf_lock in NMI context. Instead,
- * it uses an alternative implementation that temporary stores
- * the strings into a per-CPU buffer. The content of the buffer
- * is later flushed into the main ring buffer via IRQ work.
+ * printk() could not take logbuf_lock in NMI context. NMI messages
+ * now go to the lockless ring in front of the main ring buffer, and
+ * only when that is full, or when printk() recurses, an alternative
+ * implementation temporary stores the strings into a per-CPU buffer.
+ * The content of the buffer is later flushed into the main ring buffer
+ * via IRQ work.
  *
  * The alternative implementation is chosen transparently
  * by examinig current printk() context mask stored in @printk_context
@@ -361,20 +363,21 @@ void __printk_safe_exit(void)
 __printf(1, 0) int vprintk_func(const char *fmt, va_list args)
 {
 	/*
-	 * Try to use the main logbuf even in NMI. But avoid calling console
-	 * drivers that might have their own locks.
+	 * The lockless ring takes messages even in NMI. But avoid calling
+	 * console drivers that might have their own locks.
 	 */
-	if ((this_cpu_read(printk_context) & PRINTK_NMI_DIRECT_CONTEXT_MASK) &&
-	    raw_spin_trylock(&logbuf_lock)) {
+	if (this_cpu_read(printk_context) &
+	    (PRINTK_NMI_DIRECT_CONTEXT_MASK | PRINTK_NMI_CONTEXT_MASK)) {
 		int len;
 
-		len = vprintk_store(0, LOGLEVEL_DEFAULT, NULL, 0, fmt, args);
-		raw_spin_unlock(&logbuf_lock);
-		defer_console_output();
-		return len;
+		len = printk_ring_store(0, LOGLEVEL_DEFAULT, NULL, 0, fmt, args);
+		if (len >= 0) {
+			defer_console_output();
+			return len;
+		}
 	}
 
-	/* Use extra buffer in NMI when logbuf_lock is taken or in safe mode. */
+	/* Use extra buffer in NMI when the ring is full or in safe mode. */
 	if (this_cpu_read(printk_context) & PRINTK_NMI_CONTEXT_MASK)
 		return vprintk_nmi(fmt, args);
 
@@ -22,6 +22,7 @@
 #include <linux/time.h>
 #include <linux/cpu.h>
 #include <linux/prefetch.h>
+#include <linux/slab.h>
 
 #include "rcu.h"
 
@@ -150,6 +151,23 @@ void call_rcu(struct rcu_head *head, rcu_callback_t func)
 }
 EXPORT_SYMBOL_GPL(call_rcu);
 
+/*
+ * Queue a kfree_rcu() request.  A NULL @head denotes the headless form,
+ * where @func is the object itself: wait for a grace period in place.
+ */
+void kfree_call_rcu(struct rcu_head *head, rcu_callback_t func)
+{
+	if (head) {
+		call_rcu(head, func);
+		return;
+	}
+
+	might_sleep();
+	synchronize_rcu();
+	kfree((void *)func);
+}
+EXPORT_SYMBOL_GPL(kfree_call_rcu);
+
 void __init rcu_init(void)
 {
 	open_softirq(RCU_SOFTIRQ, rcu_process_callbacks);
@@ -961,6 +961,7 @@ static inline void __set_task_cpu(struct task_struct *p, unsigned int cpu)
 #else
 	WRITE_ONCE(task_thread_info(p)->cpu, cpu);
 #endif
+	p->wake_cpu = cpu;
 #endif
 }
 
@@ -1389,6 +1390,12 @@ static inline int best_mask_cpu(int cpu, cpumask_t *cpumask)
 #define WF_FORK		0x02		/* child wakeup after fork */
 #define WF_MIGRATED	0x04		/* internal use, task got migrated */
 
+/*
+ * Among the CPUs at the lowest watermark, pick the one closest to
+ * p->wake_cpu.  That is the task's last CPU unless somebody steered the
+ * wakeup elsewhere while the task was off the runqueue, as workqueue does
+ * to keep unbound workers inside their affinity scope.
+ */
 static inline int select_task_rq(struct task_struct *p)
 {
 	cpumask_t chk_mask, tmp;
@@ -1401,13 +1408,13 @@ static inline int select_task_rq(struct task_struct *p)
 	level = bmq_find_first_bit(sched_rq_watermark_bitmap, WM_BITS);
 	while (level < preempt_level) {
 		if (cpumask_and(&tmp, &chk_mask, &sched_rq_watermark[level]))
-			return best_mask_cpu(task_cpu(p), &tmp);
+			return best_mask_cpu(p->wake_cpu, &tmp);
 
 		level = bmq_find_next_bit(sched_rq_watermark_bitmap, WM_BITS,
 					  level + 1);
 	}
 
-	return best_mask_cpu(task_cpu(p), &chk_mask);
+	return best_mask_cpu(p->wake_cpu, &chk_mask);
 }
 #else /* CONFIG_SMP */
 static inline int select_task_rq(struct task_struct *p)
@@ -3071,6 +3078,7 @@ static void __sched notrace __schedule(bool preempt)
 			schedstat_inc(rq->sched_goidle);
 
 		rq->curr = next;
+		membarrier_switch_mm(prev->mm, next->mm);
 		/*
 		 * The membarrier system call requires each architecture
 		 * to have a full memory barrier after updating
@@ -3423,6 +3423,7 @@ static void __sched notrace __schedule(bool preempt)
 	if (likely(prev != next)) {
 		rq->nr_switches++;
 		rq->curr = next;
+		membarrier_switch_mm(prev->mm, next->mm);
 		/*
 		 * The membarrier system call requires each architecture
 		 * to have a full memory barrier after updating
@@ -100,18 +100,16 @@ static int membarrier_global_expedited(void)
 
 static int membarrier_private_expedited(int flags)
 {
-	int cpu;
-	bool fallback = false;
-	cpumask_var_t tmpmask;
+	struct mm_struct *mm = current->mm;
 
 	if (flags & MEMBARRIER_FLAG_SYNC_CORE) {
 		if (!IS_ENABLED(CONFIG_ARCH_HAS_MEMBARRIER_SYNC_CORE))
 			return -EINVAL;
-		if (!(atomic_read(&current->mm->membarrier_state) &
+		if (!(atomic_read(&mm->membarrier_state) &
 		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_SYNC_CORE_READY))
 			return -EPERM;
 	} else {
-		if (!(atomic_read(&current->mm->membarrier_state) &
+		if (!(atomic_read(&mm->membarrier_state) &
 		      MEMBARRIER_STATE_PRIVATE_EXPEDITED_READY))
 			return -EPERM;
 	}
@@ -126,45 +124,17 @@ static int membarrier_private_expedited(int flags)
 	smp_mb();	/* system call entry is not a mb. */
 
 	/*
-	 * Expedited membarrier commands guarantee that they won't
-	 * block, hence the GFP_NOWAIT allocation flag and fallback
-	 * implementation.
+	 * Only the CPUs running a task of this mm are interrupted, as
+	 * tracked by membarrier_switch_mm() next to the rq->curr updates.
+	 * smp_call_function_many() copes with the mask changing under it
+	 * and skips the current CPU, which is in program order with
+	 * respect to the caller thread. Disabling preemption keeps the
+	 * caller on that CPU for the duration of the call.
 	 */
-	if (!zalloc_cpumask_var(&tmpmask, GFP_NOWAIT)) {
-		/* Fallback for OOM. */
-		fallback = true;
-	}
-
 	cpus_read_lock();
-	for_each_online_cpu(cpu) {
-		struct task_struct *p;
-
-		/*
-		 * Skipping the current CPU is OK even through we can be
-		 * migrated at any point. The current CPU, at the point
-		 * where we read raw_smp_processor_id(), is ensured to
-		 * be in program order with respect to the caller
-		 * thread. Therefore, we can skip this CPU from the
-		 * iteration.
-		 */
-		if (cpu == raw_smp_processor_id())
-			continue;
-		rcu_read_lock();
-		p = task_rcu_dereference(&cpu_rq(cpu)->curr);
-		if (p && p->mm == current->mm) {
-			if (!fallback)
-				__cpumask_set_cpu(cpu, tmpmask);
-			else
-				smp_call_function_single(cpu, ipi_mb, NULL, 1);
-		}
-		rcu_read_unlock();
-	}
-	if (!fallback) {
-		preempt_disable();
-		smp_call_function_many(tmpmask, ipi_mb, NULL, 1);
-		preempt_enable();
-		free_cpumask_var(tmpmask);
-	}
+	preempt_disable();
+	smp_call_function_many(mm_membarrier_cpumask(mm), ipi_mb, NULL, 1);
+	preempt_enable();
 	cpus_read_unlock();
 
 	/*
@@ -1792,6 +1792,20 @@ static struct ctl_table fs_table[] = {
 		.mode		= 0444,
 		.proc_handler	= proc_nr_dentry,
 	},
+	{
+		.procname	= "negative-dentry-limit",
+		.data		= &sysctl_negative_dentry_limit,
+		.maxlen		= sizeof(sysctl_negative_dentry_limit),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
+	{
+		.procname	= "negative-dentry-dir-limit",
+		.data		= &sysctl_negative_dentry_dir_limit,
+		.maxlen		= sizeof(sysctl_negative_dentry_dir_limit),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec,
+	},
 	{
 		.procname	= "overflowuid",
 		.data		= &fs_overflowuid,
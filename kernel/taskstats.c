@@ -38,7 +38,8 @@ static const struct nla_policy taskstats_cmd_get_policy[TASKSTATS_CMD_ATTR_MAX+1
 	[TASKSTATS_CMD_ATTR_PID]  = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_TGID] = { .type = NLA_U32 },
 	[TASKSTATS_CMD_ATTR_REGISTER_CPUMASK] = { .type = NLA_STRING },
-	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },};
+	[TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK] = { .type = NLA_STRING },
+	[TASKSTATS_CMD_ATTR_CGROUP_FD] = { .type = NLA_U32 },};
 
 /*
  * We have to use TASKSTATS_CMD_ATTR_MAX here, it is the maxattr in the family.
@@ -192,9 +193,14 @@ static int fill_stats_for_pid(pid_t pid, struct taskstats *stats)
 	return 0;
 }
 
-static int fill_stats_for_tgid(pid_t tgid, struct taskstats *stats)
+/*
+ * Must be called under rcu_read_lock() with @first found by pid lookup,
+ * so that the task_struct is still valid.
+ */
+static int __fill_stats_for_tgid(struct task_struct *first,
+				 struct taskstats *stats)
 {
-	struct task_struct *tsk, *first;
+	struct task_struct *tsk;
 	unsigned long flags;
 	int rc = -ESRCH;
 	u64 delta, utime, stime;
@@ -204,10 +210,7 @@ static int fill_stats_for_tgid(pid_t tgid, struct taskstats *stats)
 	 * Add additional stats from live tasks except zombie thread group
 	 * leaders who are already counted with the dead tasks
 	 */
-	rcu_read_lock();
-	first = find_task_by_vpid(tgid);
-
-	if (!first || !lock_task_sighand(first, &flags))
+	if (!lock_task_sighand(first, &flags))
 		goto out;
 
 	if (first->signal->stats)
@@ -245,8 +248,6 @@ static int fill_stats_for_tgid(pid_t tgid, struct taskstats *stats)
 	unlock_task_sighand(first, &flags);
 	rc = 0;
 out:
-	rcu_read_unlock();
-
 	stats->version = TASKSTATS_VERSION;
 	/*
 	 * Accounting subsystems can also add calls here to modify
@@ -255,6 +256,20 @@ static int fill_stats_for_tgid(pid_t tgid, struct taskstats *stats)
 	return rc;
 }
 
+static int fill_stats_for_tgid(pid_t tgid, struct taskstats *stats)
+{
+	struct task_struct *first;
+	int rc = -ESRCH;
+
+	rcu_read_lock();
+	first = find_task_by_vpid(tgid);
+	if (first)
+		rc = __fill_stats_for_tgid(first, stats);
+	rcu_read_unlock();
+
+	return rc;
+}
+
 static void fill_tgid_exit(struct task_struct *tsk)
 {
 	unsigned long flags;
@@ -551,6 +566,144 @@ static int taskstats_user_cmd(struct sk_buff *skb, struct genl_info *info)
 		return -EINVAL;
 }
 
+/*
+ * A dump of TASKSTATS_CMD_GET returns one TASKSTATS_TYPE_AGGR_TGID message
+ * per thread group in the requester's pid namespace, optionally restricted
+ * to the members of a cgroup, so that a monitor can collect the statistics
+ * of every process in a few recvmsg() calls instead of one request each.
+ *
+ * The pid namespace and cgroup are taken from the requester when the dump
+ * starts; the next tgid to report is kept across the dump's callbacks.
+ */
+struct taskstats_dump {
+	struct pid_namespace	*pid_ns;
+	struct cgroup		*cgrp;
+	pid_t			next_tgid;
+};
+
+static int taskstats_dump_start(struct netlink_callback *cb)
+{
+	struct nlattr *attrs[TASKSTATS_CMD_ATTR_MAX + 1];
+	struct taskstats_dump *dump;
+	int rc;
+
+	rc = nlmsg_parse_deprecated(cb->nlh, GENL_HDRLEN, attrs,
+				    TASKSTATS_CMD_ATTR_MAX,
+				    taskstats_cmd_get_policy, cb->extack);
+	if (rc < 0)
+		return rc;
+
+	dump = kzalloc(sizeof(*dump), GFP_KERNEL);
+	if (!dump)
+		return -ENOMEM;
+
+	if (attrs[TASKSTATS_CMD_ATTR_CGROUP_FD]) {
+		u32 fd = nla_get_u32(attrs[TASKSTATS_CMD_ATTR_CGROUP_FD]);
+
+		dump->cgrp = cgroup_get_from_fd(fd);
+		if (IS_ERR(dump->cgrp)) {
+			rc = PTR_ERR(dump->cgrp);
+			kfree(dump);
+			return rc;
+		}
+	}
+
+	dump->pid_ns = get_pid_ns(task_active_pid_ns(current));
+	dump->next_tgid = 1;
+	cb->args[0] = (long)dump;
+	return 0;
+}
+
+static int taskstats_dump_done(struct netlink_callback *cb)
+{
+	struct taskstats_dump *dump = (struct taskstats_dump *)cb->args[0];
+
+	if (dump) {
+		if (dump->cgrp)
+			cgroup_put(dump->cgrp);
+		put_pid_ns(dump->pid_ns);
+		kfree(dump);
+	}
+	return 0;
+}
+
+/*
+ * Fill in the stats for the first thread group at or after dump->next_tgid.
+ * Returns 1 if a message was added to @skb, 0 when there are no more thread
+ * groups, or a negative error if @skb is full.
+ */
+static int taskstats_dump_one(struct sk_buff *skb, struct netlink_callback *cb,
+			      struct taskstats_dump *dump)
+{
+	struct task_struct *task;
+	struct taskstats *stats;
+	struct pid *pid;
+	pid_t tgid;
+	void *hdr;
+	int rc = 0;
+
+	rcu_read_lock();
+	for (;;) {
+		pid = find_ge_pid(dump->next_tgid, dump->pid_ns);
+		if (!pid)
+			goto out;
+
+		tgid = pid_nr_ns(pid, dump->pid_ns);
+		dump->next_tgid = tgid + 1;
+		task = pid_task(pid, PIDTYPE_TGID);
+		if (!task)
+			continue;
+		if (dump->cgrp && !task_under_cgroup_hierarchy(task, dump->cgrp))
+			continue;
+		break;
+	}
+
+	rc = -EMSGSIZE;
+	hdr = genlmsg_put(skb, NETLINK_CB(cb->skb).portid, cb->nlh->nlmsg_seq,
+			  &family, NLM_F_MULTI, TASKSTATS_CMD_NEW);
+	if (!hdr)
+		goto out;
+
+	stats = mk_reply(skb, TASKSTATS_TYPE_TGID, tgid);
+	if (!stats) {
+		genlmsg_cancel(skb, hdr);
+		goto out;
+	}
+
+	/* An exiting group is simply reported with what has been gathered */
+	__fill_stats_for_tgid(task, stats);
+	genlmsg_end(skb, hdr);
+	rc = 1;
+out:
+	rcu_read_unlock();
+	return rc;
+}
+
+static int taskstats_dump(struct sk_buff *skb, struct netlink_callback *cb)
+{
+	struct taskstats_dump *dump = (struct taskstats_dump *)cb->args[0];
+	pid_t tgid;
+	int rc;
+
+	for (;;) {
+		tgid = dump->next_tgid;
+		rc = taskstats_dump_one(skb, cb, dump);
+		if (rc <= 0)
+			break;
+		cond_resched();
+	}
+
+	if (rc < 0) {
+		/* retry this thread group in the next skb */
+		dump->next_tgid = tgid;
+		/* a single record that doesn't fit an empty skb never will */
+		if (!skb->len)
+			return rc;
+	}
+
+	return skb->len;
+}
+
 static struct taskstats *taskstats_tgid_alloc(struct task_struct *tsk)
 {
 	struct signal_struct *sig = tsk->signal;
@@ -641,6 +794,9 @@ static const struct genl_ops taskstats_ops[] = {
 		.cmd		= TASKSTATS_CMD_GET,
 		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
 		.doit		= taskstats_user_cmd,
+		.start		= taskstats_dump_start,
+		.dumpit		= taskstats_dump,
+		.done		= taskstats_dump_done,
 		/* policy enforced later */
 		.flags		= GENL_ADMIN_PERM | GENL_CMD_CAP_HASPOL,
 	},
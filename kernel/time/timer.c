@@ -178,18 +178,22 @@ EXPORT_SYMBOL(jiffies_64);
 #define WHEEL_TIMEOUT_MAX	(WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
 
 /*
- * The resulting wheel size. If NOHZ is configured we allocate two
- * wheels so we have a separate storage for the deferrable timers.
+ * The resulting wheel size. If NOHZ is configured we allocate three
+ * wheels: the local one for pinned timers, the global one for timers
+ * which may be expired by another CPU while this one is idle, and a
+ * separate storage for the deferrable timers.
  */
 #define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
 
 #ifdef CONFIG_NO_HZ_COMMON
-# define NR_BASES	2
-# define BASE_STD	0
-# define BASE_DEF	1
+# define NR_BASES	3
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	1
+# define BASE_DEF	2
 #else
 # define NR_BASES	1
-# define BASE_STD	0
+# define BASE_LOCAL	0
+# define BASE_GLOBAL	0
 # define BASE_DEF	0
 #endif
 
@@ -829,30 +833,29 @@ static int detach_if_pending(struct timer_list *timer, struct timer_base *base,
 	return 1;
 }
 
-static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
+static inline unsigned int get_timer_base_idx(u32 tflags)
 {
-	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_STD], cpu);
-
 	/*
-	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
+	 * If NO_HZ_COMMON is set then deferrable timers use the deferrable
+	 * base and non-pinned timers the global base.
 	 */
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = per_cpu_ptr(&timer_bases[BASE_DEF], cpu);
-	return base;
+	if (IS_ENABLED(CONFIG_NO_HZ_COMMON)) {
+		if (tflags & TIMER_DEFERRABLE)
+			return BASE_DEF;
+		if (!(tflags & TIMER_PINNED))
+			return BASE_GLOBAL;
+	}
+	return BASE_LOCAL;
 }
 
-static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+static inline struct timer_base *get_timer_cpu_base(u32 tflags, u32 cpu)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	return per_cpu_ptr(&timer_bases[get_timer_base_idx(tflags)], cpu);
+}
 
-	/*
-	 * If the timer is deferrable and NO_HZ_COMMON is set then we need
-	 * to use the deferrable base.
-	 */
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON) && (tflags & TIMER_DEFERRABLE))
-		base = this_cpu_ptr(&timer_bases[BASE_DEF]);
-	return base;
+static inline struct timer_base *get_timer_this_cpu_base(u32 tflags)
+{
+	return this_cpu_ptr(&timer_bases[get_timer_base_idx(tflags)]);
 }
 
 static inline struct timer_base *get_timer_base(u32 tflags)
@@ -860,14 +863,15 @@ static inline struct timer_base *get_timer_base(u32 tflags)
 	return get_timer_cpu_base(tflags, tflags & TIMER_CPUMASK);
 }
 
+/*
+ * Timers are always queued on the local CPU. Non-pinned ones end up in the
+ * global base, which the timer migration hierarchy expires on behalf of
+ * the CPU once it goes idle, so there is no need to pick a busy target
+ * CPU at enqueue time.
+ */
 static inline struct timer_base *
 get_target_base(struct timer_base *base, unsigned tflags)
 {
-#if defined(CONFIG_SMP) && defined(CONFIG_NO_HZ_COMMON)
-	if (static_branch_likely(&timers_migration_enabled) &&
-	    !(tflags & TIMER_PINNED))
-		return get_timer_cpu_base(tflags, get_nohz_timer_target());
-#endif
 	return get_timer_this_cpu_base(tflags);
 }
 
@@ -1133,11 +1137,30 @@ void add_timer(struct timer_list *timer)
 }
 EXPORT_SYMBOL(add_timer);
 
+/**
+ * add_timer_global - start a timer without TIMER_PINNED set
+ * @timer: the timer to be added
+ *
+ * Same as add_timer() except that a TIMER_PINNED flag left behind by an
+ * earlier add_timer_on() is dropped first, so the timer may again be
+ * queued on the global base and expired by any CPU.
+ */
+void add_timer_global(struct timer_list *timer)
+{
+	WRITE_ONCE(timer->flags, timer->flags & ~TIMER_PINNED);
+	add_timer(timer);
+}
+EXPORT_SYMBOL(add_timer_global);
+
 /**
  * add_timer_on - start a timer on a particular CPU
  * @timer: the timer to be added
  * @cpu: the CPU to start it on
  *
+ * The timer is pinned to @cpu, i.e. it is never expired by another CPU on
+ * behalf of an idle @cpu. The pin sticks to @timer until it is re-armed
+ * with add_timer_global().
+ *
  * This is not very scalable on SMP. Double adds are not possible.
  */
 void add_timer_on(struct timer_list *timer, int cpu)
@@ -1147,7 +1170,11 @@ void add_timer_on(struct timer_list *timer, int cpu)
 
 	BUG_ON(timer_pending(timer) || !timer->function);
 
-	new_base = get_timer_cpu_base(timer->flags, cpu);
+	/*
+	 * The timer has to run on @cpu, so it must not end up in the global
+	 * base from where an idle @cpu's timers are expired remotely.
+	 */
+	new_base = get_timer_cpu_base(timer->flags | TIMER_PINNED, cpu);
 
 	/*
 	 * If @timer was on a different CPU, it should be migrated with the
@@ -1162,7 +1189,9 @@ void add_timer_on(struct timer_list *timer, int cpu)
 		base = new_base;
 		raw_spin_lock(&base->lock);
 		WRITE_ONCE(timer->flags,
-			   (timer->flags & ~TIMER_BASEMASK) | cpu);
+			   (timer->flags & ~TIMER_BASEMASK) | cpu | TIMER_PINNED);
+	} else {
+		WRITE_ONCE(timer->flags, timer->flags | TIMER_PINNED);
 	}
 	forward_timer_base(base);
 
@@ -1511,29 +1540,18 @@ static u64 cmp_next_hrtimer_event(u64 basem, u64 expires)
 	return DIV_ROUND_UP_ULL(nextevt, TICK_NSEC) * TICK_NSEC;
 }
 
-/**
- * get_next_timer_interrupt - return the time (clock mono) of the next timer
- * @basej:	base time jiffies
- * @basem:	base time clock monotonic
- *
- * Returns the tick aligned clock monotonic time of the next pending
- * timer or KTIME_MAX if no timer is pending.
+/*
+ * Look up the first pending timer of @base, store it as the base's next
+ * expiry and forward the base clock. Returns the tick aligned clock
+ * monotonic time of that timer relative to @basej/@basem, KTIME_MAX if no
+ * timer is pending. Caller must hold base->lock.
  */
-u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+static u64 fetch_next_timer_event(struct timer_base *base,
+				  unsigned long basej, u64 basem)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-	u64 expires = KTIME_MAX;
 	unsigned long nextevt;
 	bool is_max_delta;
 
-	/*
-	 * Pretend that there is no timer pending if the cpu is offline.
-	 * Possible pending timers will be migrated later to an active cpu.
-	 */
-	if (cpu_is_offline(smp_processor_id()))
-		return expires;
-
-	raw_spin_lock(&base->lock);
 	nextevt = __next_timer_interrupt(base);
 	is_max_delta = (nextevt == base->clk + NEXT_TIMER_MAX_DELTA);
 	base->next_expiry = nextevt;
@@ -1549,25 +1567,72 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 			base->clk = nextevt;
 	}
 
-	if (time_before_eq(nextevt, basej)) {
-		expires = basem;
-		base->is_idle = false;
-	} else {
-		if (!is_max_delta)
-			expires = basem + (u64)(nextevt - basej) * TICK_NSEC;
-		/*
-		 * If we expect to sleep more than a tick, mark the base idle.
-		 * Also the tick is stopped so any added timer must forward
-		 * the base clk itself to keep granularity small. This idle
-		 * logic is only maintained for the BASE_STD base, deferrable
-		 * timers may still see large granularity skew (by design).
-		 */
-		if ((expires - basem) > TICK_NSEC) {
-			base->must_forward_clk = true;
-			base->is_idle = true;
-		}
+	if (time_before_eq(nextevt, basej))
+		return basem;
+	if (is_max_delta)
+		return KTIME_MAX;
+	return basem + (u64)(nextevt - basej) * TICK_NSEC;
+}
+
+/**
+ * get_next_timer_interrupt - return the time (clock mono) of the next timer
+ * @basej:	base time jiffies
+ * @basem:	base time clock monotonic
+ *
+ * Returns the tick aligned clock monotonic time of the next pending
+ * timer or KTIME_MAX if no timer is pending. When the CPU is about to
+ * sleep, the global timers are handed over to the timer migration
+ * hierarchy and only taken into account if this CPU has to expire them.
+ */
+u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
+{
+	struct timer_base *base_local = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
+	struct timer_base *base_global = this_cpu_ptr(&timer_bases[BASE_GLOBAL]);
+	u64 expires, tevt_local, tevt_global;
+	bool is_idle;
+
+	/*
+	 * Pretend that there is no timer pending if the cpu is offline.
+	 * Possible pending timers will be migrated later to an active cpu.
+	 */
+	if (cpu_is_offline(smp_processor_id()))
+		return KTIME_MAX;
+
+	raw_spin_lock(&base_local->lock);
+	raw_spin_lock_nested(&base_global->lock, SINGLE_DEPTH_NESTING);
+
+	tevt_local = fetch_next_timer_event(base_local, basej, basem);
+	tevt_global = fetch_next_timer_event(base_global, basej, basem);
+	expires = min(tevt_local, tevt_global);
+
+	/*
+	 * If we expect to sleep more than a tick, mark the bases idle.
+	 * Also the tick is stopped so any added timer must forward
+	 * the base clk itself to keep granularity small. This idle
+	 * logic is only maintained for the local and global bases,
+	 * deferrable timers may still see large granularity skew (by
+	 * design).
+	 */
+	is_idle = (expires - basem) > TICK_NSEC;
+	if (is_idle) {
+		base_local->must_forward_clk = true;
+		base_global->must_forward_clk = true;
+	}
+	base_local->is_idle = is_idle;
+	base_global->is_idle = is_idle;
+
+#ifdef CONFIG_TIMER_MIGRATION
+	/*
+	 * Let the CPUs which are still active expire the global timers,
+	 * unless this is the last one of them.
+	 */
+	if (is_idle && static_branch_likely(&timers_migration_enabled)) {
+		tevt_global = tmigr_cpu_deactivate(tevt_global);
+		expires = min(tevt_local, tevt_global);
 	}
-	raw_spin_unlock(&base->lock);
+#endif
+	raw_spin_unlock(&base_global->lock);
+	raw_spin_unlock(&base_local->lock);
 
 	return cmp_next_hrtimer_event(basem, expires);
 }
@@ -1579,15 +1644,17 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
  */
 void timer_clear_idle(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
-
 	/*
 	 * We do this unlocked. The worst outcome is a remote enqueue sending
 	 * a pointless IPI, but taking the lock would just make the window for
 	 * sending the IPI a few instructions smaller for the cost of taking
 	 * the lock in the exit from idle path.
 	 */
-	base->is_idle = false;
+	__this_cpu_write(timer_bases[BASE_LOCAL].is_idle, false);
+	__this_cpu_write(timer_bases[BASE_GLOBAL].is_idle, false);
+
+	/* Expire the global timers locally again */
+	tmigr_cpu_activate();
 }
 
 static int collect_expired_timers(struct timer_base *base,
@@ -1660,11 +1727,22 @@ static inline void __run_timers(struct timer_base *base)
 
 	raw_spin_lock_irq(&base->lock);
 
+	/*
+	 * The global base of an idle CPU is expired remotely by the timer
+	 * migration hierarchy. If somebody else is already running the
+	 * timers of @base, leave the rest of them to it, two expiries must
+	 * not run concurrently.
+	 */
+	if (base->running_timer) {
+		raw_spin_unlock_irq(&base->lock);
+		return;
+	}
+
 	/*
 	 * timer_base::must_forward_clk must be cleared before running
 	 * timers so that any timer functions that call mod_timer() will
 	 * not try to forward the base. Idle tracking / clock forwarding
-	 * logic is only used with BASE_STD timers.
+	 * logic is only used with BASE_LOCAL and BASE_GLOBAL timers.
 	 *
 	 * The must_forward_clk flag is cleared unconditionally also for
 	 * the deferrable base. The deferrable base is not affected by idle
@@ -1693,28 +1771,60 @@ static inline void __run_timers(struct timer_base *base)
  */
 static __latent_entropy void run_timer_softirq(struct softirq_action *h)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
 
 	__run_timers(base);
-	if (IS_ENABLED(CONFIG_NO_HZ_COMMON))
+	if (IS_ENABLED(CONFIG_NO_HZ_COMMON)) {
+		__run_timers(this_cpu_ptr(&timer_bases[BASE_GLOBAL]));
 		__run_timers(this_cpu_ptr(&timer_bases[BASE_DEF]));
+		tmigr_handle_remote();
+	}
 }
 
+#ifdef CONFIG_TIMER_MIGRATION
+/**
+ * timer_expire_remote - expire the global timers of an idle CPU
+ * @cpu:	The idle CPU
+ *
+ * Called from the timer migration hierarchy on behalf of @cpu, which is
+ * handed the new first expiry of its global timers afterwards.
+ */
+void timer_expire_remote(unsigned int cpu)
+{
+	struct timer_base *base = per_cpu_ptr(&timer_bases[BASE_GLOBAL], cpu);
+	unsigned long basej;
+	u64 basem;
+
+	__run_timers(base);
+
+	basem = get_jiffies_update(&basej);
+	raw_spin_lock_irq(&base->lock);
+	tmigr_cpu_update_remote(cpu, fetch_next_timer_event(base, basej, basem));
+	/* __run_timers() cleared it, but @cpu is still idle */
+	base->must_forward_clk = base->is_idle;
+	raw_spin_unlock_irq(&base->lock);
+}
+#endif
+
 /*
  * Called by the local, per-CPU timer interrupt on SMP.
  */
 void run_local_timers(void)
 {
-	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_STD]);
+	struct timer_base *base = this_cpu_ptr(&timer_bases[BASE_LOCAL]);
 
 	hrtimer_run_queues();
 	/* Raise the softirq only if required. */
 	if (time_before(jiffies, base->clk)) {
 		if (!IS_ENABLED(CONFIG_NO_HZ_COMMON))
 			return;
-		/* CPU is awake, so check the deferrable base. */
-		base++;
-		if (time_before(jiffies, base->clk))
+		/*
+		 * CPU is awake, so check the global and deferrable bases and
+		 * the global timers of idle CPUs it is in charge of.
+		 */
+		if (time_before(jiffies, base[BASE_GLOBAL].clk) &&
+		    time_before(jiffies, base[BASE_DEF].clk) &&
+		    !tmigr_requires_handle_remote())
 			return;
 	}
 	raise_softirq(TIMER_SOFTIRQ);
@@ -16,6 +16,7 @@
 #include <linux/uaccess.h>
 
 #include "tick-internal.h"
+#include "timer_migration.h"
 
 struct timer_list_iter {
 	int cpu;
@@ -185,6 +186,20 @@ static void print_cpu(struct seq_file *m, int cpu, u64 now)
 
 #undef P
 #undef P_ns
+
+#ifdef CONFIG_TIMER_MIGRATION
+# define P(x) \
+	SEQ_printf(m, "  .%-15s: %Lu\n", "tmigr_" #x, \
+		   (unsigned long long)(tmc->x))
+	{
+		struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+		P(idle);
+		P(wakeups);
+		P(remote);
+		P(saved);
+	}
+# undef P
+#endif
 	SEQ_printf(m, "\n");
 }
 
@@ -276,7 +291,7 @@ static void timer_list_show_tickdevices_header(struct seq_file *m)
 
 static inline void timer_list_header(struct seq_file *m, u64 now)
 {
-	SEQ_printf(m, "Timer List Version: v0.8\n");
+	SEQ_printf(m, "Timer List Version: v0.9\n");
 	SEQ_printf(m, "HRTIMER_MAX_CLOCK_BASES: %d\n", HRTIMER_MAX_CLOCK_BASES);
 	SEQ_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
 	SEQ_printf(m, "\n");
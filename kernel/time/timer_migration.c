@@ -0,0 +1,507 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Infrastructure for migratable timers
+ *
+ * Non-pinned timers are queued in the global timer base of the CPU which
+ * arms them. While a CPU is busy it expires its global timers itself. When
+ * it goes idle it hands the first of them over to a hierarchy of groups
+ * instead of programming a wakeup, so that the global timers of idle CPUs
+ * are expired by the CPUs which are still awake.
+ *
+ * The hierarchy follows the topology: CPUs sharing a last level cache are
+ * gathered in level 0 groups, these are combined per NUMA node and the node
+ * groups are combined up to a single top level group. No group has more
+ * than TMIGR_CHILDREN_PER_GROUP children.
+ *
+ * Every group tracks which of its children are active. One active child is
+ * the migrator of the group: it expires the events which the inactive
+ * children queued in the group. When the last child of a group goes idle,
+ * the group itself becomes inactive and queues its first event in its
+ * parent group. When the last active CPU of the whole system goes idle,
+ * it is handed the first event of the top level group and programs its
+ * wakeup for it.
+ *
+ * Locking: the per CPU lock nests outside of the group locks, and group
+ * locks are taken bottom up, the parent lock before dropping the child
+ * lock, so that state changes propagate in order. The level of a group
+ * is its lockdep subclass. The timer base locks nest outside of all of
+ * them.
+ */
+#include <linux/cpuhotplug.h>
+#include <linux/init.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/sched/nohz.h>
+#include <linux/sched/topology.h>
+
+#include "tick-internal.h"
+#include "timer_migration.h"
+
+DEFINE_PER_CPU(struct tmigr_cpu, tmigr_cpu);
+
+static void tmigr_update_next(struct tmigr_group *group)
+{
+	struct timerqueue_node *next = timerqueue_getnext(&group->events);
+
+	WRITE_ONCE(group->next_expiry, next ? next->expires : KTIME_MAX);
+}
+
+/*
+ * (Re)queue @evt in @group with expiry @expires. KTIME_MAX removes the
+ * event. Caller holds group->lock.
+ */
+static void tmigr_queue_event(struct tmigr_group *group,
+			      struct tmigr_event *evt, u64 expires)
+{
+	if (!RB_EMPTY_NODE(&evt->nextevt.node))
+		timerqueue_del(&group->events, &evt->nextevt);
+
+	if (expires != KTIME_MAX) {
+		evt->nextevt.expires = expires;
+		timerqueue_add(&group->events, &evt->nextevt);
+	}
+	tmigr_update_next(group);
+}
+
+/*
+ * Walk up from @group and requeue the event @evt of the child @childmask
+ * with expiry @expires. With @deactivate set the child is marked inactive
+ * first. Every group which has no active child left queues its own first
+ * event in its parent.
+ *
+ * Returns the first event of the top level group when the walk reached
+ * it, i.e. when no CPU is active anymore. KTIME_MAX otherwise.
+ *
+ * Called with the per CPU lock held and interrupts disabled.
+ */
+static u64 tmigr_update_events(struct tmigr_group *group, u8 childmask,
+			       struct tmigr_event *evt, u64 expires,
+			       bool deactivate)
+{
+	struct timerqueue_node *first;
+	struct tmigr_group *parent;
+	u64 nextexp = KTIME_MAX;
+	unsigned int cpu;
+
+	raw_spin_lock(&group->lock);
+	for (;;) {
+		if (deactivate) {
+			group->active &= ~childmask;
+			/* Hand the migrator duty to the lowest active child */
+			if (group->migrator == childmask)
+				group->migrator = group->active & -group->active;
+		}
+		tmigr_queue_event(group, evt, expires);
+
+		/* The migrator of the group takes care of the event */
+		if (group->active)
+			break;
+
+		parent = group->parent;
+		if (!parent) {
+			nextexp = group->next_expiry;
+			break;
+		}
+
+		first = timerqueue_getnext(&group->events);
+		cpu = first ? container_of(first, struct tmigr_event, nextevt)->cpu : 0;
+		expires = group->next_expiry;
+		childmask = group->childmask;
+		evt = &group->groupevt;
+
+		raw_spin_lock_nested(&parent->lock, parent->level);
+		/* Queued in the parent, so it is protected by the parent lock */
+		evt->cpu = cpu;
+		raw_spin_unlock(&group->lock);
+		group = parent;
+	}
+	raw_spin_unlock(&group->lock);
+
+	return nextexp;
+}
+
+/*
+ * Mark the child @childmask of @group active and remove its event @evt.
+ * Groups which had no active child before become active in their parent
+ * as well.
+ *
+ * Called with the per CPU lock held and interrupts disabled.
+ */
+static void tmigr_active_up(struct tmigr_group *group, u8 childmask,
+			    struct tmigr_event *evt)
+{
+	struct tmigr_group *parent;
+	bool was_idle;
+
+	raw_spin_lock(&group->lock);
+	for (;;) {
+		was_idle = !group->active;
+		group->active |= childmask;
+		if (!group->migrator)
+			group->migrator = childmask;
+		/* An active child expires its timers itself */
+		tmigr_queue_event(group, evt, KTIME_MAX);
+
+		parent = group->parent;
+		if (!was_idle || !parent)
+			break;
+
+		childmask = group->childmask;
+		evt = &group->groupevt;
+
+		raw_spin_lock_nested(&parent->lock, parent->level);
+		raw_spin_unlock(&group->lock);
+		group = parent;
+	}
+	raw_spin_unlock(&group->lock);
+}
+
+/**
+ * tmigr_cpu_activate - mark the current CPU active in the hierarchy
+ *
+ * Called with interrupts disabled when the CPU leaves idle. The CPU expires
+ * its global timers itself from now on.
+ */
+void tmigr_cpu_activate(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+
+	/* Only the CPU itself sets @idle, so this can be checked unlocked */
+	if (!tmc->idle)
+		return;
+
+	raw_spin_lock(&tmc->lock);
+	tmc->idle = false;
+	tmigr_active_up(tmc->tmgroup, tmc->childmask, &tmc->cpuevt);
+	raw_spin_unlock(&tmc->lock);
+}
+
+/**
+ * tmigr_cpu_deactivate - hand the global timers of the going idle CPU over
+ * @nextexp:	First expiry of the CPU's global timers, KTIME_MAX if none
+ *
+ * Called with interrupts disabled and the CPU's timer bases locked, from
+ * the idle path and again on every interrupt exit while the CPU stays idle.
+ *
+ * Returns the expiry the CPU has to wake up for on behalf of the global
+ * timers: KTIME_MAX when an active CPU takes care of them, the first event
+ * of the whole hierarchy when this was the last active CPU, or @nextexp
+ * itself when the CPU does not take part in the hierarchy.
+ */
+u64 tmigr_cpu_deactivate(u64 nextexp)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	u64 ret;
+
+	if (!tmc->online)
+		return nextexp;
+
+	raw_spin_lock(&tmc->lock);
+	tmc->idle = true;
+	ret = tmigr_update_events(tmc->tmgroup, tmc->childmask, &tmc->cpuevt,
+				  nextexp, true);
+	raw_spin_unlock(&tmc->lock);
+
+	return ret;
+}
+
+/**
+ * tmigr_cpu_update_remote - update the first global timer of an idle CPU
+ * @cpu:	The idle CPU whose global timers were expired remotely
+ * @nextexp:	New first expiry of @cpu's global timers, KTIME_MAX if none
+ *
+ * Called from timer_expire_remote() with @cpu's global timer base locked,
+ * so it cannot race with @cpu handing over a newer expiry itself. Nothing
+ * is done when @cpu went back to expiring its timers itself meanwhile.
+ */
+void tmigr_cpu_update_remote(unsigned int cpu, u64 nextexp)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+	raw_spin_lock(&tmc->lock);
+	if (tmc->idle) {
+		if (cpu != smp_processor_id())
+			tmc->saved++;
+		/*
+		 * The returned first event of the hierarchy, if any, is picked
+		 * up by the expiring CPU itself on its way back to idle.
+		 */
+		tmigr_update_events(tmc->tmgroup, tmc->childmask, &tmc->cpuevt,
+				    nextexp, false);
+	}
+	raw_spin_unlock(&tmc->lock);
+}
+
+/*
+ * Expire the due events of @group. Bounded, so that a CPU which keeps
+ * rearming an already expired timer cannot stall the softirq. Left over
+ * events are handled on the next tick.
+ */
+static unsigned int tmigr_handle_group(struct tmigr_group *group)
+{
+	struct timerqueue_node *next;
+	unsigned int cpu, handled;
+	unsigned long basej;
+	u64 now;
+
+	for (handled = 0; handled < TMIGR_CHILDREN_PER_GROUP; handled++) {
+		now = get_jiffies_update(&basej);
+
+		raw_spin_lock_irq(&group->lock);
+		next = timerqueue_getnext(&group->events);
+		if (!next || next->expires > now) {
+			raw_spin_unlock_irq(&group->lock);
+			break;
+		}
+		cpu = container_of(next, struct tmigr_event, nextevt)->cpu;
+		raw_spin_unlock_irq(&group->lock);
+
+		timer_expire_remote(cpu);
+		if (cpu != smp_processor_id())
+			this_cpu_inc(tmigr_cpu.remote);
+	}
+	return handled;
+}
+
+/**
+ * tmigr_handle_remote - expire the global timers of idle CPUs
+ *
+ * Called from the timer softirq. Walks up the groups in which the current
+ * CPU is the migrator, or which have no active child at all, and expires
+ * the due timers of their inactive children.
+ */
+void tmigr_handle_remote(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group;
+	unsigned int handled = 0;
+	u8 childmask, migrator;
+
+	if (!tmc->online)
+		return;
+
+	childmask = tmc->childmask;
+	for (group = tmc->tmgroup; group; group = group->parent) {
+		migrator = READ_ONCE(group->migrator);
+		if (migrator && migrator != childmask)
+			break;
+		handled += tmigr_handle_group(group);
+		childmask = group->childmask;
+	}
+
+	if (handled && tmc->idle)
+		tmc->wakeups++;
+}
+
+/**
+ * tmigr_requires_handle_remote - check whether remote expiry is due
+ *
+ * Called from the tick. Lockless, tmigr_handle_remote() revalidates under
+ * the group locks.
+ */
+bool tmigr_requires_handle_remote(void)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	struct tmigr_group *group;
+	unsigned long basej;
+	u8 childmask, migrator;
+	u64 expires, now = 0;
+
+	if (!tmc->online)
+		return false;
+
+	childmask = tmc->childmask;
+	for (group = tmc->tmgroup; group; group = group->parent) {
+		migrator = READ_ONCE(group->migrator);
+		if (migrator && migrator != childmask)
+			break;
+
+		expires = READ_ONCE(group->next_expiry);
+		if (expires != KTIME_MAX) {
+			if (!now)
+				now = get_jiffies_update(&basej);
+			if (expires <= now)
+				return true;
+		}
+		childmask = group->childmask;
+	}
+	return false;
+}
+
+static int tmigr_cpu_online(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+
+	raw_spin_lock_irq(&tmc->lock);
+	tmc->online = true;
+	tmc->idle = false;
+	tmigr_active_up(tmc->tmgroup, tmc->childmask, &tmc->cpuevt);
+	raw_spin_unlock_irq(&tmc->lock);
+
+	return 0;
+}
+
+static int tmigr_cpu_offline(unsigned int cpu)
+{
+	struct tmigr_cpu *tmc = this_cpu_ptr(&tmigr_cpu);
+	unsigned int target;
+	u64 firstexp;
+
+	/* The timers of the CPU are migrated by timers_dead_cpu() */
+	raw_spin_lock_irq(&tmc->lock);
+	tmc->online = false;
+	tmc->idle = false;
+	firstexp = tmigr_update_events(tmc->tmgroup, tmc->childmask,
+				       &tmc->cpuevt, KTIME_MAX, true);
+	raw_spin_unlock_irq(&tmc->lock);
+
+	/*
+	 * This was the last active CPU. Kick an idle one, so that it picks
+	 * up the first event of the hierarchy on its way back to idle.
+	 */
+	if (firstexp != KTIME_MAX) {
+		target = cpumask_any_but(cpu_online_mask, cpu);
+		if (target < nr_cpu_ids)
+			wake_up_nohz_cpu(target);
+	}
+	return 0;
+}
+
+static struct tmigr_group * __init tmigr_group_alloc(int node)
+{
+	struct tmigr_group *group;
+
+	group = kzalloc_node(sizeof(*group), GFP_KERNEL, node);
+	if (!group)
+		return NULL;
+
+	raw_spin_lock_init(&group->lock);
+	timerqueue_init_head(&group->events);
+	timerqueue_init(&group->groupevt.nextevt);
+	group->next_expiry = KTIME_MAX;
+	group->numa_node = node;
+	return group;
+}
+
+static void __init tmigr_connect_cpu(unsigned int cpu, struct tmigr_group *group)
+{
+	struct tmigr_cpu *tmc = per_cpu_ptr(&tmigr_cpu, cpu);
+
+	raw_spin_lock_init(&tmc->lock);
+	timerqueue_init(&tmc->cpuevt.nextevt);
+	tmc->cpuevt.cpu = cpu;
+	tmc->tmgroup = group;
+	tmc->childmask = BIT(group->num_children++);
+}
+
+/*
+ * Combine the @nr groups in @groups into parents of at most
+ * TMIGR_CHILDREN_PER_GROUP children, level by level, until a single group
+ * is left. The parents of each level are stored in place. Returns the
+ * remaining group or NULL on allocation failure.
+ */
+static struct tmigr_group * __init
+tmigr_connect_levels(struct tmigr_group **groups, unsigned int nr, int node)
+{
+	struct tmigr_group *child, *parent = NULL;
+	unsigned int i, n;
+
+	while (nr > 1) {
+		for (i = 0, n = 0; i < nr; i++) {
+			child = groups[i];
+			if (!(i % TMIGR_CHILDREN_PER_GROUP)) {
+				parent = tmigr_group_alloc(node);
+				if (!parent)
+					return NULL;
+				groups[n++] = parent;
+			}
+			child->parent = parent;
+			child->childmask = BIT(parent->num_children++);
+			parent->level = max(parent->level, child->level + 1);
+		}
+		nr = n;
+	}
+	return groups[0];
+}
+
+/*
+ * CPUs which did not come up yet have no cache topology. Keep them
+ * together per node.
+ */
+static bool __init tmigr_cpus_share_cache(int a, int b)
+{
+	if (!cpu_online(a) || !cpu_online(b))
+		return !cpu_online(a) && !cpu_online(b);
+	return cpus_share_cache(a, b);
+}
+
+static int __init tmigr_init(void)
+{
+	struct tmigr_group **groups, **roots, *group, *top;
+	unsigned int cpu, sibling, nr, start, nr_roots = 0;
+	cpumask_var_t done;
+	int node, ret = -ENOMEM;
+
+	if (!zalloc_cpumask_var(&done, GFP_KERNEL))
+		return -ENOMEM;
+
+	groups = kcalloc(nr_cpu_ids, sizeof(*groups), GFP_KERNEL);
+	roots = kcalloc(nr_node_ids, sizeof(*roots), GFP_KERNEL);
+	if (!groups || !roots)
+		goto out;
+
+	for_each_node(node) {
+		/* Level 0: CPUs of the node sharing the last level cache */
+		nr = 0;
+		for_each_possible_cpu(cpu) {
+			if (cpu_to_node(cpu) != node || cpumask_test_cpu(cpu, done))
+				continue;
+
+			group = NULL;
+			for_each_possible_cpu(sibling) {
+				if (cpu_to_node(sibling) != node ||
+				    cpumask_test_cpu(sibling, done) ||
+				    !tmigr_cpus_share_cache(cpu, sibling))
+					continue;
+
+				if (!group ||
+				    group->num_children == TMIGR_CHILDREN_PER_GROUP) {
+					group = tmigr_group_alloc(node);
+					if (!group)
+						goto out;
+					groups[nr++] = group;
+				}
+				tmigr_connect_cpu(sibling, group);
+				cpumask_set_cpu(sibling, done);
+			}
+		}
+		if (!nr)
+			continue;
+
+		roots[nr_roots] = tmigr_connect_levels(groups, nr, node);
+		if (!roots[nr_roots++])
+			goto out;
+	}
+
+	/* Combine the node groups up to the top level */
+	top = tmigr_connect_levels(roots, nr_roots, NUMA_NO_NODE);
+	if (!top)
+		goto out;
+
+	ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "timers/migration:online",
+				tmigr_cpu_online, tmigr_cpu_offline);
+	if (ret < 0)
+		goto out;
+
+	pr_info("Timer migration: %u hierarchy levels; %u children per group\n",
+		top->level + 1, TMIGR_CHILDREN_PER_GROUP);
+	ret = 0;
+out:
+	if (ret)
+		pr_err("Timer migration setup failed\n");
+	free_cpumask_var(done);
+	kfree(roots);
+	kfree(groups);
+	return ret;
+}
+core_initcall(tmigr_init);
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _KERNEL_TIME_MIGRATION_H
+#define _KERNEL_TIME_MIGRATION_H
+
+#include <linux/percpu.h>
+#include <linux/spinlock.h>
+#include <linux/timerqueue.h>
+
+/* Per group capacity, bounded by the width of the child masks */
+#define TMIGR_CHILDREN_PER_GROUP	8
+
+/**
+ * struct tmigr_event - a timer event handed to the migration hierarchy
+ * @nextevt:	Node to enqueue the event in the group timer queue
+ * @cpu:	CPU whose global timer base has to be expired for the event
+ */
+struct tmigr_event {
+	struct timerqueue_node	nextevt;
+	unsigned int		cpu;
+};
+
+/**
+ * struct tmigr_group - timer migration hierarchy group
+ * @lock:		Lock protecting the state and the event queue of
+ *			the group
+ * @parent:		Parent group, NULL for the top level group
+ * @groupevt:		First event of the group. Queued in the parent
+ *			group while this group has no active child
+ * @next_expiry:	Expiry of the first event in @events, KTIME_MAX if
+ *			the queue is empty. Read locklessly in the tick
+ * @events:		Timer queue holding the first event of every
+ *			inactive child
+ * @active:		Bitmask of the active children
+ * @migrator:		Childmask of the active child in charge of expiring
+ *			@events, 0 when all children are inactive
+ * @childmask:		Bit of this group in the @active mask of the parent
+ * @num_children:	Number of children connected to this group
+ * @level:		Level of the group, 0 for groups holding CPUs
+ * @numa_node:		Node of the group's CPUs, NUMA_NO_NODE for groups
+ *			spanning several nodes
+ */
+struct tmigr_group {
+	raw_spinlock_t		lock;
+	struct tmigr_group	*parent;
+	struct tmigr_event	groupevt;
+	u64			next_expiry;
+	struct timerqueue_head	events;
+	u8			active;
+	u8			migrator;
+	u8			childmask;
+	unsigned int		num_children;
+	unsigned int		level;
+	int			numa_node;
+};
+
+/**
+ * struct tmigr_cpu - timer migration per CPU state
+ * @lock:		Lock protecting the per CPU state
+ * @online:		CPU takes part in the hierarchy
+ * @idle:		CPU is idle and handed its global timers over to the
+ *			hierarchy
+ * @childmask:		Bit of this CPU in the @active mask of @tmgroup
+ * @tmgroup:		Level 0 group of this CPU
+ * @cpuevt:		First global timer of this CPU while it is idle
+ * @wakeups:		Idle wakeups to expire timers on behalf of the hierarchy
+ * @remote:		Global timer bases of other CPUs expired by this CPU
+ * @saved:		Expiries of this CPU's global timers done remotely
+ *			while it stayed idle
+ */
+struct tmigr_cpu {
+	raw_spinlock_t		lock;
+	bool			online;
+	bool			idle;
+	u8			childmask;
+	struct tmigr_group	*tmgroup;
+	struct tmigr_event	cpuevt;
+	unsigned long		wakeups;
+	unsigned long		remote;
+	unsigned long		saved;
+};
+
+DECLARE_PER_CPU(struct tmigr_cpu, tmigr_cpu);
+
+#endif
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * futex-wait-multiple: Measure the wake latency of FUTEX_WAIT_MULTIPLE.
+ *
+ * A single waiter blocks on a set of futexes with FUTEX_WAIT_MULTIPLE while
+ * the main thread wakes them one at a time, round-robin.  The latency is
+ * the time from the FUTEX_WAKE that found the waiter to the waiter running
+ * again.  With -n 1 the waiter uses plain FUTEX_WAIT instead, as a baseline.
+ */
+
+/* For the CLR_() macros */
+#include <string.h>
+#include <pthread.h>
+
+#include <signal.h>
+#include "../util/stat.h"
+#include <subcmd/parse-options.h>
+#include <linux/compiler.h>
+#include <linux/kernel.h>
+#include <linux/time64.h>
+#include <errno.h>
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <stdlib.h>
+#include <time.h>
+
+static u_int32_t *futexes;
+static struct futex_wait_block *blocks;
+
+static unsigned int nfutexes = 8;
+static unsigned int nloops = 10000;
+static bool done = false, silent = false, fshared = false;
+static int futex_flag = 0;
+
+/* Set by the waiter each time it returns from a wait */
+static volatile unsigned int nwoken;
+static volatile int wait_error;
+static struct timespec woken_at;
+
+static struct stats latency_stats;
+
+static const struct option options[] = {
+	OPT_UINTEGER('n', "nfutexes", &nfutexes, "Specify amount of futexes to wait on"),
+	OPT_UINTEGER('l', "loops",    &nloops,   "Specify amount of wakeups per run"),
+	OPT_BOOLEAN( 's', "silent",   &silent,   "Silent mode: do not display data/details"),
+	OPT_BOOLEAN( 'S', "shared",   &fshared,  "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_wait_multiple_usage[] = {
+	"perf bench futex wait-multiple <options>",
+	NULL
+};
+
+static u64 timespec_ns(struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static void *waiterfn(void *arg __maybe_unused)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < nloops; i++) {
+		do {
+			if (nfutexes == 1)
+				ret = futex_wait(&futexes[0], 0, NULL,
+						 futex_flag);
+			else
+				ret = futex_wait_multiple(blocks, nfutexes,
+							  NULL, futex_flag);
+		} while (ret < 0 && errno == EINTR);
+
+		if (ret < 0) {
+			wait_error = errno;
+			break;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &woken_at);
+		__atomic_store_n(&nwoken, i + 1, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+static void toggle_done(int sig __maybe_unused,
+			siginfo_t *info __maybe_unused,
+			void *uc __maybe_unused)
+{
+	done = true;
+}
+
+int bench_futex_wait_multiple(int argc, const char **argv)
+{
+	struct sigaction act;
+	pthread_t waiter;
+	unsigned int i, j;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_wait_multiple_usage, 0);
+	if (argc || !nfutexes || !nloops) {
+		usage_with_options(bench_futex_wait_multiple_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	sigfillset(&act.sa_mask);
+	act.sa_sigaction = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+
+	futexes = calloc(nfutexes, sizeof(*futexes));
+	blocks = calloc(nfutexes, sizeof(*blocks));
+	if (!futexes || !blocks)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	for (i = 0; i < nfutexes; i++) {
+		blocks[i].uaddr = &futexes[i];
+		blocks[i].val = 0;
+		blocks[i].bitset = FUTEX_BITSET_MATCH_ANY;
+	}
+
+	printf("Run summary [PID %d]: waiting on %d [%s] futexes with %s, "
+	       "%d wakeups per run.\n\n", getpid(), nfutexes,
+	       fshared ? "shared" : "private",
+	       nfutexes == 1 ? "FUTEX_WAIT" : "FUTEX_WAIT_MULTIPLE", nloops);
+
+	init_stats(&latency_stats);
+
+	for (j = 0; j < bench_repeat && !done; j++) {
+		struct stats run_stats;
+
+		init_stats(&run_stats);
+		nwoken = 0;
+		wait_error = 0;
+
+		if (pthread_create(&waiter, NULL, waiterfn, NULL))
+			err(EXIT_FAILURE, "pthread_create");
+
+		for (i = 0; i < nloops && !wait_error; i++) {
+			u_int32_t *f = &futexes[i % nfutexes];
+			struct timespec start;
+			u64 latency;
+
+			/* Retry until the waiter has queued itself again */
+			do {
+				clock_gettime(CLOCK_MONOTONIC, &start);
+			} while (!futex_wake(f, 1, futex_flag) && !wait_error);
+
+			while (__atomic_load_n(&nwoken, __ATOMIC_ACQUIRE) != i + 1 &&
+			       !wait_error)
+				;
+
+			latency = timespec_ns(&woken_at) - timespec_ns(&start);
+			update_stats(&run_stats, latency);
+			update_stats(&latency_stats, latency);
+		}
+
+		pthread_join(waiter, NULL);
+		if (wait_error) {
+			errno = wait_error;
+			err(EXIT_FAILURE, "futex wait");
+		}
+
+		if (!silent) {
+			printf("[Run %d]: Average wake latency %.0f ns (+-%.2f%%)\n",
+			       j + 1, avg_stats(&run_stats),
+			       rel_stddev_stats(stddev_stats(&run_stats),
+						avg_stats(&run_stats)));
+		}
+	}
+
+	printf("Average wake latency: %.0f ns (+-%.2f%%)\n",
+	       avg_stats(&latency_stats),
+	       rel_stddev_stats(stddev_stats(&latency_stats),
+				avg_stats(&latency_stats)));
+
+	free(blocks);
+	free(futexes);
+	return 0;
+}
@@ -74,6 +74,29 @@ futex_unlock_pi(u_int32_t *uaddr, int opflags)
 	return futex(uaddr, FUTEX_UNLOCK_PI, 0, NULL, NULL, 0, opflags);
 }
 
+#ifndef FUTEX_WAIT_MULTIPLE
+#define FUTEX_WAIT_MULTIPLE	31
+struct futex_wait_block {
+	u_int32_t *uaddr;
+#if __SIZEOF_POINTER__ == 4
+	u_int32_t __pad;
+#endif
+	u_int32_t val;
+	u_int32_t bitset;
+};
+#endif
+
+/**
+ * futex_wait_multiple() - block on any of @count futexes described by @fwb
+ * @timeout:	relative timeout
+ */
+static inline int
+futex_wait_multiple(struct futex_wait_block *fwb, int count,
+		    struct timespec *timeout, int opflags)
+{
+	return futex(fwb, FUTEX_WAIT_MULTIPLE, count, timeout, NULL, 0, opflags);
+}
+
 /**
 * futex_cmp_requeue() - requeue tasks from uaddr to uaddr2
 * @nr_wake:        wake up to this many tasks
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/kernel.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#ifndef __NR_close_range
+#define __NR_close_range -1
+#endif
+
+#ifndef CLOSE_RANGE_UNSHARE
+#define CLOSE_RANGE_UNSHARE	(1U << 1)
+#endif
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC	(1U << 2)
+#endif
+
+static inline int sys_close_range(unsigned int fd, unsigned int max_fd,
+				  unsigned int flags)
+{
+	return syscall(__NR_close_range, fd, max_fd, flags);
+}
+
+#define NR_TEST_FDS 101
+
+static void open_fds(int *fds, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		fds[i] = open("/dev/null", O_RDONLY);
+		if (fds[i] < 0)
+			ksft_exit_fail_msg("Failed to open /dev/null: %s\n",
+					   strerror(errno));
+	}
+}
+
+static bool fd_is_open(int fd)
+{
+	return fcntl(fd, F_GETFD) >= 0;
+}
+
+static void test_close_range_supported(void)
+{
+	int ret;
+
+	/* An empty range starting past any open fd is a no-op */
+	ret = sys_close_range(INT_MAX - 1, INT_MAX, 0);
+	if (ret < 0) {
+		if (errno == ENOSYS)
+			ksft_exit_skip("close_range() syscall not supported\n");
+		ksft_exit_fail_msg("close_range() failed: %s\n",
+				   strerror(errno));
+	}
+
+	ksft_test_result_pass("close_range() syscall is supported\n");
+}
+
+static void test_close_range_invalid(void)
+{
+	if (sys_close_range(10, 9, 0) == 0 || errno != EINVAL)
+		ksft_exit_fail_msg("close_range() accepted first > last\n");
+
+	if (sys_close_range(0, 0, 1U << 31) == 0 || errno != EINVAL)
+		ksft_exit_fail_msg("close_range() accepted unknown flags\n");
+
+	ksft_test_result_pass("close_range() rejects invalid arguments\n");
+}
+
+static void test_close_range(void)
+{
+	int fds[NR_TEST_FDS];
+	int i;
+
+	open_fds(fds, NR_TEST_FDS);
+
+	/* close the first half, leave a hole in the middle */
+	if (sys_close_range(fds[0], fds[50], 0))
+		ksft_exit_fail_msg("close_range() failed: %s\n",
+				   strerror(errno));
+
+	for (i = 0; i <= 50; i++)
+		if (fd_is_open(fds[i]))
+			ksft_exit_fail_msg("fd %d still open\n", fds[i]);
+
+	if (!fd_is_open(fds[51]))
+		ksft_exit_fail_msg("fd %d closed outside the range\n",
+				   fds[51]);
+
+	/* a range well past the end of the table closes the rest */
+	if (sys_close_range(fds[51], UINT_MAX, 0))
+		ksft_exit_fail_msg("close_range() failed: %s\n",
+				   strerror(errno));
+
+	for (i = 51; i < NR_TEST_FDS; i++)
+		if (fd_is_open(fds[i]))
+			ksft_exit_fail_msg("fd %d still open\n", fds[i]);
+
+	ksft_test_result_pass("close_range() closes the requested range\n");
+}
+
+static void test_close_range_cloexec(void)
+{
+	int fds[NR_TEST_FDS];
+	int i, flags;
+
+	open_fds(fds, NR_TEST_FDS);
+
+	if (sys_close_range(fds[0], fds[NR_TEST_FDS - 2], CLOSE_RANGE_CLOEXEC))
+		ksft_exit_fail_msg("close_range(CLOSE_RANGE_CLOEXEC) failed: %s\n",
+				   strerror(errno));
+
+	for (i = 0; i < NR_TEST_FDS; i++) {
+		flags = fcntl(fds[i], F_GETFD);
+		if (flags < 0)
+			ksft_exit_fail_msg("fd %d was closed\n", fds[i]);
+		if (i < NR_TEST_FDS - 1 && !(flags & FD_CLOEXEC))
+			ksft_exit_fail_msg("fd %d is not close-on-exec\n",
+					   fds[i]);
+		if (i == NR_TEST_FDS - 1 && (flags & FD_CLOEXEC))
+			ksft_exit_fail_msg("fd %d outside the range is close-on-exec\n",
+					   fds[i]);
+	}
+
+	sys_close_range(fds[0], fds[NR_TEST_FDS - 1], 0);
+	ksft_test_result_pass("close_range() marks the range close-on-exec\n");
+}
+
+static int wait_for_pid(pid_t pid)
+{
+	int status, ret;
+
+again:
+	ret = waitpid(pid, &status, 0);
+	if (ret == -1) {
+		if (errno == EINTR)
+			goto again;
+
+		return -1;
+	}
+
+	if (!WIFEXITED(status))
+		return -1;
+
+	return WEXITSTATUS(status);
+}
+
+static void test_close_range_unshare(void)
+{
+	int fds[NR_TEST_FDS];
+	pid_t pid;
+	int i;
+
+	open_fds(fds, NR_TEST_FDS);
+
+	/* the child shares our fd table */
+	pid = syscall(__NR_clone, CLONE_FILES | SIGCHLD, NULL, NULL, NULL, NULL);
+	if (pid < 0)
+		ksft_exit_fail_msg("Failed to create new process\n");
+
+	if (pid == 0) {
+		if (sys_close_range(fds[0], UINT_MAX, CLOSE_RANGE_UNSHARE))
+			_exit(EXIT_FAILURE);
+
+		for (i = 0; i < NR_TEST_FDS; i++)
+			if (fd_is_open(fds[i]))
+				_exit(EXIT_FAILURE);
+
+		_exit(EXIT_SUCCESS);
+	}
+
+	if (wait_for_pid(pid) != EXIT_SUCCESS)
+		ksft_exit_fail_msg("close_range(CLOSE_RANGE_UNSHARE) failed in child\n");
+
+	/* our copy of the table must be untouched */
+	for (i = 0; i < NR_TEST_FDS; i++)
+		if (!fd_is_open(fds[i]))
+			ksft_exit_fail_msg("fd %d closed in the parent\n",
+					   fds[i]);
+
+	sys_close_range(fds[0], fds[NR_TEST_FDS - 1], 0);
+	ksft_test_result_pass("close_range() unshares the fd table\n");
+}
+
+int main(int argc, char **argv)
+{
+	ksft_print_header();
+	ksft_set_plan(5);
+
+	test_close_range_supported();
+	test_close_range_invalid();
+	test_close_range();
+	test_close_range_cloexec();
+	test_close_range_unshare();
+
+	return ksft_exit_pass();
+}
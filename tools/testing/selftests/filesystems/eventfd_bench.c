@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Producer-to-consumer notification benchmark for eventfd.
+ *
+ * A producer thread hands items to a consumer thread through a shared
+ * counter and notifies it through an eventfd.  In "plain" mode every item
+ * is followed by write(); in "shared-word" mode the eventfd is created with
+ * EFD_SHARED_WORD and the producer only calls write() when the mapped word
+ * says the consumer is sleeping.  Reports the time per item and how many
+ * write() calls were made.
+ *
+ * Usage: eventfd_bench [-n items]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/eventfd.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_ITEMS		1000000
+
+static long items = DEFAULT_ITEMS;
+static int efd;
+static uint32_t *word;
+static volatile long posted;
+static long writes;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void notify(void)
+{
+	uint64_t one = 1;
+
+	if (write(efd, &one, sizeof(one)) != sizeof(one)) {
+		perror("write");
+		exit(1);
+	}
+	writes++;
+}
+
+static void *producer(void *arg)
+{
+	long i;
+
+	for (i = 0; i < items; i++) {
+		__atomic_store_n(&posted, i + 1, __ATOMIC_SEQ_CST);
+		if (!word ||
+		    __atomic_exchange_n(word, EFD_WORD_AWAKE,
+					__ATOMIC_SEQ_CST) == EFD_WORD_SLEEPING)
+			notify();
+	}
+	return NULL;
+}
+
+static void consume(void)
+{
+	long seen = 0;
+	uint64_t cnt;
+
+	while (seen < items) {
+		if (__atomic_load_n(&posted, __ATOMIC_SEQ_CST) > seen) {
+			seen = posted;
+			continue;
+		}
+		if (word) {
+			__atomic_store_n(word, EFD_WORD_SLEEPING,
+					 __ATOMIC_SEQ_CST);
+			if (__atomic_load_n(&posted, __ATOMIC_SEQ_CST) > seen) {
+				__atomic_store_n(word, EFD_WORD_AWAKE,
+						 __ATOMIC_SEQ_CST);
+				continue;
+			}
+		}
+		if (read(efd, &cnt, sizeof(cnt)) < 0 && errno != EAGAIN) {
+			perror("read");
+			exit(1);
+		}
+		if (word)
+			__atomic_store_n(word, EFD_WORD_AWAKE, __ATOMIC_SEQ_CST);
+	}
+}
+
+static int run(const char *name, int flags)
+{
+	unsigned long long start, elapsed;
+	pthread_t thread;
+
+	efd = syscall(__NR_eventfd2, 0, flags);
+	if (efd < 0) {
+		if (errno == EINVAL && flags) {
+			printf("%s: EFD_SHARED_WORD not supported, skipped\n",
+			       name);
+			return 0;
+		}
+		perror("eventfd2");
+		return 1;
+	}
+
+	word = NULL;
+	if (flags & EFD_SHARED_WORD) {
+		word = mmap(NULL, getpagesize(), PROT_READ | PROT_WRITE,
+			    MAP_SHARED, efd, 0);
+		if (word == MAP_FAILED) {
+			perror("mmap");
+			return 1;
+		}
+	}
+	posted = 0;
+	writes = 0;
+
+	start = now_ns();
+	if (pthread_create(&thread, NULL, producer, NULL)) {
+		fprintf(stderr, "pthread_create failed\n");
+		return 1;
+	}
+	consume();
+	pthread_join(thread, NULL);
+	elapsed = now_ns() - start;
+
+	printf("%s: %llu ns per item, %ld writes for %ld items\n",
+	       name, elapsed / items, writes, items);
+
+	if (word)
+		munmap(word, getpagesize());
+	close(efd);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			items = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n items]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (items <= 0) {
+		fprintf(stderr, "items must be positive\n");
+		return 1;
+	}
+
+	if (run("plain", 0))
+		return 1;
+	return run("shared-word", EFD_SHARED_WORD);
+}
@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Create/stat/unlink microbenchmark.
+ *
+ * Each thread works in its own directory under the given path and
+ * repeatedly creates a file, stats it and unlinks it.  Every create and
+ * unlink adds and removes an inode on the superblock inode list and the
+ * inode hash, so with enough threads this shows contention on those.
+ *
+ * Usage: inode_bench [-t threads] [-n iterations] [dir]
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_THREADS		4
+#define DEFAULT_ITERATIONS	100000
+
+static const char *base = ".";
+static long iterations = DEFAULT_ITERATIONS;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *worker(void *arg)
+{
+	char dir[PATH_MAX], name[PATH_MAX + 32];
+	long id = (long)arg, i;
+	struct stat st;
+	int fd;
+
+	snprintf(dir, sizeof(dir), "%s/inode_bench.%d.%ld", base, getpid(), id);
+	if (mkdir(dir, 0700)) {
+		perror("mkdir");
+		exit(1);
+	}
+
+	for (i = 0; i < iterations; i++) {
+		snprintf(name, sizeof(name), "%s/%ld", dir, i);
+		fd = open(name, O_CREAT | O_EXCL | O_WRONLY, 0600);
+		if (fd < 0) {
+			perror("open");
+			exit(1);
+		}
+		close(fd);
+		if (stat(name, &st) || unlink(name)) {
+			perror(name);
+			exit(1);
+		}
+	}
+
+	rmdir(dir);
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	int nr_threads = DEFAULT_THREADS;
+	unsigned long long start, elapsed;
+	pthread_t *threads;
+	long i;
+	int c;
+
+	while ((c = getopt(argc, argv, "t:n:")) != -1) {
+		switch (c) {
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		case 'n':
+			iterations = atol(optarg);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-t threads] [-n iterations] [dir]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc)
+		base = argv[optind];
+	if (nr_threads <= 0 || iterations <= 0) {
+		fprintf(stderr, "threads and iterations must be positive\n");
+		return 1;
+	}
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	if (!threads)
+		return 1;
+
+	start = now_ns();
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&threads[i], NULL, worker, (void *)i)) {
+			fprintf(stderr, "pthread_create failed\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(threads[i], NULL);
+	elapsed = now_ns() - start;
+
+	printf("%d threads: %llu create/stat/unlink per second, %llu ns each\n",
+	       nr_threads,
+	       nr_threads * iterations * 1000000000ULL / elapsed,
+	       elapsed / iterations);
+	return 0;
+}
@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/******************************************************************************
+ *
+ * DESCRIPTION
+ *      Test FUTEX_WAIT_MULTIPLE: the value mismatch, timeout and argument
+ *      checks, and that a waiter is woken by a FUTEX_WAKE on any one of
+ *      its futexes and reports which one.
+ *
+ *****************************************************************************/
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "futextest.h"
+#include "logging.h"
+
+#define TEST_NAME "futex-wait-multiple"
+#define NR_FUTEXES 8
+#define WAKE_IDX 5
+
+static long timeout_ns = 100000;	/* 100us default timeout */
+static futex_t futexes[NR_FUTEXES];
+static struct futex_wait_block fwb[NR_FUTEXES];
+
+void usage(char *prog)
+{
+	printf("Usage: %s\n", prog);
+	printf("  -c	Use color\n");
+	printf("  -h	Display this help message\n");
+	printf("  -t N	Timeout in nanoseconds (default: 100,000)\n");
+	printf("  -v L	Verbosity level: %d=QUIET %d=CRITICAL %d=INFO\n",
+	       VQUIET, VCRITICAL, VINFO);
+}
+
+static void setup_blocks(void)
+{
+	int i;
+
+	for (i = 0; i < NR_FUTEXES; i++) {
+		futexes[i] = FUTEX_INITIALIZER;
+		fwb[i].uaddr = (u_int32_t *)&futexes[i];
+		fwb[i].val = FUTEX_INITIALIZER;
+		fwb[i].bitset = FUTEX_BITSET_MATCH_ANY;
+	}
+}
+
+static void *waiterfn(void *arg)
+{
+	long *res = arg;
+
+	*res = futex_wait_multiple(fwb, NR_FUTEXES, NULL, FUTEX_PRIVATE_FLAG);
+	if (*res < 0)
+		*res = -errno;
+	return NULL;
+}
+
+static int test_wouldblock(void)
+{
+	struct timespec to = {.tv_sec = 0, .tv_nsec = timeout_ns};
+	int res;
+
+	setup_blocks();
+	fwb[NR_FUTEXES - 1].val = FUTEX_INITIALIZER + 1;
+
+	info("Calling futex_wait_multiple with one mismatching value\n");
+	res = futex_wait_multiple(fwb, NR_FUTEXES, &to, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != EWOULDBLOCK) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		return RET_FAIL;
+	}
+	return RET_PASS;
+}
+
+static int test_timeout(void)
+{
+	struct timespec to = {.tv_sec = 0, .tv_nsec = timeout_ns};
+	int res;
+
+	setup_blocks();
+
+	info("Calling futex_wait_multiple with a %ldns timeout\n", timeout_ns);
+	res = futex_wait_multiple(fwb, NR_FUTEXES, &to, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != ETIMEDOUT) {
+		fail("futex_wait_multiple returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		return RET_FAIL;
+	}
+	return RET_PASS;
+}
+
+static int test_einval(void)
+{
+	int res;
+
+	setup_blocks();
+
+	info("Calling futex_wait_multiple with no futexes\n");
+	res = futex_wait_multiple(fwb, 0, NULL, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != EINVAL) {
+		fail("futex_wait_multiple(count=0) returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		return RET_FAIL;
+	}
+
+	fwb[0].bitset = 0;
+	info("Calling futex_wait_multiple with an empty bitset\n");
+	res = futex_wait_multiple(fwb, NR_FUTEXES, NULL, FUTEX_PRIVATE_FLAG);
+	if (!res || errno != EINVAL) {
+		fail("futex_wait_multiple(bitset=0) returned: %d %s\n",
+		     res ? errno : res, res ? strerror(errno) : "");
+		return RET_FAIL;
+	}
+	return RET_PASS;
+}
+
+static int test_wake(void)
+{
+	pthread_t waiter;
+	long res = 0;
+	int ret, tries, woken = 0;
+
+	setup_blocks();
+
+	ret = pthread_create(&waiter, NULL, waiterfn, &res);
+	if (ret) {
+		error("pthread_create\n", ret);
+		return RET_ERROR;
+	}
+
+	/* Retry until the waiter has queued itself on the futexes. */
+	for (tries = 0; tries < 1000 && !woken; tries++) {
+		usleep(1000);
+		woken = futex_wake(&futexes[WAKE_IDX], 1, FUTEX_PRIVATE_FLAG);
+	}
+
+	pthread_join(waiter, NULL);
+
+	if (woken != 1) {
+		fail("futex_wake woke %d waiters\n", woken);
+		return RET_FAIL;
+	}
+	if (res != WAKE_IDX) {
+		fail("futex_wait_multiple returned %ld, expected %d\n",
+		     res, WAKE_IDX);
+		return RET_FAIL;
+	}
+	return RET_PASS;
+}
+
+int main(int argc, char *argv[])
+{
+	int ret = RET_PASS;
+	int c;
+
+	while ((c = getopt(argc, argv, "cht:v:")) != -1) {
+		switch (c) {
+		case 'c':
+			log_color(1);
+			break;
+		case 'h':
+			usage(basename(argv[0]));
+			exit(0);
+		case 't':
+			timeout_ns = atoi(optarg);
+			break;
+		case 'v':
+			log_verbosity(atoi(optarg));
+			break;
+		default:
+			usage(basename(argv[0]));
+			exit(1);
+		}
+	}
+
+	ksft_print_header();
+	ksft_set_plan(1);
+	ksft_print_msg("%s: Test FUTEX_WAIT_MULTIPLE\n",
+	       basename(argv[0]));
+
+	ret = test_wouldblock();
+	if (ret == RET_PASS)
+		ret = test_timeout();
+	if (ret == RET_PASS)
+		ret = test_einval();
+	if (ret == RET_PASS)
+		ret = test_wake();
+
+	print_result(TEST_NAME, ret);
+	return ret;
+}
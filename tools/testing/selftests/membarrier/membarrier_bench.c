@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Microbenchmark for MEMBARRIER_CMD_PRIVATE_EXPEDITED.
+ *
+ * Measures the average cost of a private expedited membarrier while the
+ * caller is the only running thread of the process, and then while a few
+ * sibling threads spin on other CPUs. Only the CPUs running threads of
+ * the process need to be interrupted, so the first case should not depend
+ * on the number of CPUs in the system.
+ *
+ * Usage: membarrier_bench [iterations]
+ */
+#define _GNU_SOURCE
+#include <linux/membarrier.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../kselftest.h"
+
+#define DEFAULT_ITERATIONS	10000
+#define MAX_SPINNERS		4
+
+static volatile int stop_spinning;
+
+static int sys_membarrier(int cmd, int flags)
+{
+	return syscall(__NR_membarrier, cmd, flags);
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *spinner(void *arg)
+{
+	while (!stop_spinning)
+		;
+	return NULL;
+}
+
+static void bench(const char *name, long iterations)
+{
+	unsigned long long start, elapsed;
+	long i;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		if (sys_membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0))
+			ksft_exit_fail_msg("%s: membarrier failed, errno = %d\n",
+					   name, errno);
+	}
+	elapsed = now_ns() - start;
+
+	ksft_test_result_pass("%s: %llu ns per call over %ld calls\n",
+			      name, elapsed / iterations, iterations);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t threads[MAX_SPINNERS];
+	long iterations = DEFAULT_ITERATIONS;
+	long nr_cpus;
+	int i, ret, nr_spinners;
+
+	if (argc > 1)
+		iterations = atol(argv[1]);
+	if (iterations <= 0)
+		iterations = DEFAULT_ITERATIONS;
+
+	ksft_print_header();
+	ksft_set_plan(2);
+
+	ret = sys_membarrier(MEMBARRIER_CMD_QUERY, 0);
+	if (ret < 0) {
+		if (errno == ENOSYS)
+			ksft_exit_skip(
+				"sys membarrier (CONFIG_MEMBARRIER) is disabled.\n");
+		ksft_exit_fail_msg("sys_membarrier() failed\n");
+	}
+	if (!(ret & MEMBARRIER_CMD_PRIVATE_EXPEDITED))
+		ksft_exit_skip(
+			"sys_membarrier unsupported: CMD_PRIVATE_EXPEDITED not found.\n");
+
+	if (sys_membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0))
+		ksft_exit_fail_msg("registration failed, errno = %d\n", errno);
+
+	nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	ksft_print_msg("%ld online CPUs\n", nr_cpus);
+
+	bench("single thread", iterations);
+
+	nr_spinners = nr_cpus - 1;
+	if (nr_spinners > MAX_SPINNERS)
+		nr_spinners = MAX_SPINNERS;
+	for (i = 0; i < nr_spinners; i++) {
+		ret = pthread_create(&threads[i], NULL, spinner, NULL);
+		if (ret)
+			ksft_exit_fail_msg("pthread_create failed: %d\n", ret);
+	}
+
+	ksft_print_msg("%d spinning sibling threads\n", nr_spinners);
+	bench("spinning siblings", iterations);
+
+	stop_spinning = 1;
+	for (i = 0; i < nr_spinners; i++)
+		pthread_join(threads[i], NULL);
+
+	return ksft_exit_pass();
+}